@@ -11,7 +11,12 @@
 
 // #define ALSA_TEST
 
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
 #include <alsa.hpp>
+#include <common.hpp>
 #include <QFile>
 
 //***************************************************************************
@@ -450,6 +455,458 @@ int QAlsaSound::fillDeviceList()
    return true;
 }
 
+//***************************************************************************
+// Class QAlsaPlayer
+//***************************************************************************
+
+QAlsaPlayer* QAlsaPlayer::player = 0;
+QHash<QString, QAlsaPlayer::Clip*> QAlsaPlayer::clips;
+
+//***************************************************************************
+// Object
+//***************************************************************************
+
+QAlsaPlayer::QAlsaPlayer()
+   : QThread()
+{
+   handle = 0;
+   running = false;
+   latencyCount = 0;
+   latencySum = 0;
+   latencyMax = 0;
+
+   for (int i = 0; i < maxVoices; i++)
+      voices[i].clip = 0;
+}
+
+QAlsaPlayer::~QAlsaPlayer()
+{
+   if (handle)
+      snd_pcm_close(handle);
+}
+
+//***************************************************************************
+// Start / Stop
+//***************************************************************************
+
+int QAlsaPlayer::start()
+{
+   QAlsaPlayer* p;
+
+   if (player)
+      return success;
+
+   if (!QAlsaSound::isAvailable())
+      return fail;
+
+   p = new QAlsaPlayer();
+
+   if (p->openDevice() != success)
+   {
+      delete p;
+      return fail;
+   }
+
+   p->running = true;
+   p->QThread::start(QThread::TimeCriticalPriority);
+   player = p;
+
+   return success;
+}
+
+void QAlsaPlayer::stop()
+{
+   QAlsaPlayer* p = player;
+
+   if (!p)
+      return ;
+
+   player = 0;
+   p->running = false;
+   p->wait();
+
+   if (p->latencyCount)
+      tell(eloAlways, "Sound latency: %d clips, trigger to audio average %.1fms, max %.1fms",
+           p->latencyCount, p->latencySum / p->latencyCount, p->latencyMax);
+
+   delete p;
+
+   // the clips are no longer referenced by any voice
+
+   foreach (Clip* clip, clips)
+   {
+      free(clip->samples);
+      delete clip;
+   }
+
+   clips.clear();
+}
+
+//***************************************************************************
+// Open Device
+//***************************************************************************
+
+int QAlsaPlayer::openDevice()
+{
+   snd_pcm_uframes_t period = periodFrames;
+   snd_pcm_uframes_t bufferSize = periodFrames * periods;
+   unsigned int r = rate;
+   snd_pcm_hw_params_t* params;
+   int err;
+
+   if ((err = snd_pcm_open(&handle, QAlsaSound::getDeviceName().toAscii(),
+                           SND_PCM_STREAM_PLAYBACK, 0)) < 0)
+   {
+      tell(eloAlways, "Cannot open audio device '%s' (%s)",
+           QAlsaSound::getDeviceName().toAscii().constData(), snd_strerror(err));
+      handle = 0;
+      return fail;
+   }
+
+   snd_pcm_hw_params_alloca(&params);
+   snd_pcm_hw_params_any(handle, params);
+
+   snd_pcm_hw_params_set_access(handle, params, SND_PCM_ACCESS_RW_INTERLEAVED);
+   snd_pcm_hw_params_set_format(handle, params, SND_PCM_FORMAT_S16_LE);
+   snd_pcm_hw_params_set_channels(handle, params, channels);
+   snd_pcm_hw_params_set_rate_near(handle, params, &r, 0);
+   snd_pcm_hw_params_set_period_size_near(handle, params, &period, 0);
+   snd_pcm_hw_params_set_buffer_size_near(handle, params, &bufferSize);
+
+   if ((err = snd_pcm_hw_params(handle, params)) < 0)
+   {
+      tell(eloAlways, "Unable to install hw params (%s)", snd_strerror(err));
+      return fail;
+   }
+
+   tell(eloDetail, "Sound device '%s' opened, rate %u, period %lu, buffer %lu frames",
+        QAlsaSound::getDeviceName().toAscii().constData(), r, period, bufferSize);
+
+   if (r != rate)
+      tell(eloAlways, "Warning: Sound device runs with %u instead of %d Hz", r, rate);
+
+   return success;
+}
+
+//***************************************************************************
+// Preload
+//***************************************************************************
+
+int QAlsaPlayer::preload(const QString& file)
+{
+   Clip* clip;
+
+   if (clips.contains(file))
+      return done;
+
+   if (!(clip = decode(file)))
+      return fail;
+
+   clips.insert(file, clip);
+
+   return success;
+}
+
+//***************************************************************************
+// Play
+//  - only queues the clip, the playback thread picks it up with
+//    the next period
+//***************************************************************************
+
+void QAlsaPlayer::play(const QString& file, int priority)
+{
+   Voice voice;
+
+   if (!player || preload(file) == fail)
+      return ;
+
+   voice.clip = clips.value(file);
+   voice.position = 0;
+   voice.priority = priority;
+   gettimeofday(&voice.triggered, 0);
+
+   // keep the pending queue sorted by priority, so a clip with high priority
+   // is never blocked by some queued with lower
+
+   player->mutex.lock();
+
+   int i = 0;
+
+   while (i < player->pending.size() && player->pending.at(i).priority >= priority)
+      i++;
+
+   player->pending.insert(i, voice);
+   player->mutex.unlock();
+}
+
+//***************************************************************************
+// Run
+//***************************************************************************
+
+void QAlsaPlayer::run()
+{
+   short buffer[periodFrames * channels];
+
+   while (running)
+   {
+      snd_pcm_sframes_t res;
+
+      takePending();
+      mix(buffer, periodFrames);
+
+      // blocks until there is room for the period
+
+      while (running && (res = snd_pcm_writei(handle, buffer, periodFrames)) < 0)
+      {
+         if (res == -EPIPE)
+            tell(eloDetail, "Sound underrun occurred");
+
+         if (snd_pcm_recover(handle, res, 1) < 0)
+         {
+            tell(eloAlways, "Sound error (%s), stopping playback", snd_strerror(res));
+            running = false;
+         }
+      }
+   }
+
+   snd_pcm_drop(handle);
+}
+
+//***************************************************************************
+// Take Pending
+//  - move the triggered clips to free voices and
+//    measure the latency they will get
+//***************************************************************************
+
+void QAlsaPlayer::takePending()
+{
+   snd_pcm_sframes_t delay = 0;
+   QList<Voice> triggered;
+   timeval now;
+
+   mutex.lock();
+   triggered = pending;
+   pending.clear();
+   mutex.unlock();
+
+   if (triggered.isEmpty())
+      return ;
+
+   gettimeofday(&now, 0);
+
+   if (snd_pcm_delay(handle, &delay) < 0)
+      delay = 0;
+
+   for (int i = 0; i < triggered.size(); i++)
+   {
+      const Voice& v = triggered.at(i);
+      int f;
+
+      if ((f = voiceFor(&v)) == na)
+      {
+         tell(eloDetail, "All voices busy, skipping '%s'", v.clip->file.toAscii().constData());
+         continue;
+      }
+
+      voices[f] = v;
+
+      double latency = ((now.tv_sec - v.triggered.tv_sec) * 1000000.0
+                        + (now.tv_usec - v.triggered.tv_usec)) / 1000.0
+         + delay * 1000.0 / rate;
+
+      latencyCount++;
+      latencySum += latency;
+      latencyMax = qMax(latencyMax, latency);
+
+      tell(eloDetail, "Sound '%s' trigger to audio %.1fms",
+           v.clip->file.toAscii().constData(), latency);
+   }
+}
+
+//***************************************************************************
+// Voice For
+//  - a free voice or the one to steal: lowest priority, on equal
+//    priority the one playing longest
+//***************************************************************************
+
+int QAlsaPlayer::voiceFor(const Voice* voice)
+{
+   int steal = na;
+
+   for (int f = 0; f < maxVoices; f++)
+   {
+      if (!voices[f].clip)
+         return f;
+
+      if (voices[f].priority > voice->priority)
+         continue;
+
+      if (steal == na || voices[f].priority < voices[steal].priority
+          || (voices[f].priority == voices[steal].priority
+              && voices[f].position > voices[steal].position))
+         steal = f;
+   }
+
+   if (steal != na)
+      tell(eloDetail, "Stealing voice of '%s' for '%s'",
+           voices[steal].clip->file.toAscii().constData(),
+           voice->clip->file.toAscii().constData());
+
+   return steal;
+}
+
+//***************************************************************************
+// Mix
+//  - add the voices with saturation, SSE2 if available
+//***************************************************************************
+
+void QAlsaPlayer::mix(short* buffer, int frames)
+{
+   memset(buffer, 0, frames * channels * sizeof(short));
+
+   for (int v = 0; v < maxVoices; v++)
+   {
+      Voice* voice = &voices[v];
+      int i = 0;
+
+      if (!voice->clip)
+         continue;
+
+      int count = qMin(frames, voice->clip->frames - voice->position) * channels;
+      const short* s = voice->clip->samples + voice->position * channels;
+
+#ifdef __SSE2__
+      for (; i + 8 <= count; i += 8)
+      {
+         __m128i a = _mm_loadu_si128((const __m128i*)(buffer + i));
+         __m128i b = _mm_loadu_si128((const __m128i*)(s + i));
+
+         _mm_storeu_si128((__m128i*)(buffer + i), _mm_adds_epi16(a, b));
+      }
+#endif
+
+      for (; i < count; i++)
+         buffer[i] = qBound(-32768, buffer[i] + s[i], 32767);
+
+      voice->position += count / channels;
+
+      if (voice->position >= voice->clip->frames)
+         voice->clip = 0;
+   }
+}
+
+//***************************************************************************
+// Decode
+//  - read the wave file and convert it to S16 stereo with 'rate'
+//***************************************************************************
+
+QAlsaPlayer::Clip* QAlsaPlayer::decode(const QString& file)
+{
+   QFile f(file);
+   QByteArray wav;
+   const unsigned char* data = 0;
+   unsigned int dataSize = 0;
+   WaveFormat format;
+   bool haveFormat = false;
+   Clip* clip;
+
+   if (!f.open(QIODevice::ReadOnly))
+   {
+      tell(eloAlways, "Can't open sound file '%s'", file.toAscii().constData());
+      return 0;
+   }
+
+   wav = f.readAll();
+   f.close();
+
+   const unsigned char* p = (const unsigned char*)wav.constData();
+   unsigned int size = wav.size();
+
+   if (size < 12 || memcmp(p, "RIFF", 4) != 0 || memcmp(p+8, "WAVE", 4) != 0)
+   {
+      tell(eloAlways, "Bad format: '%s' is not a wave file", file.toAscii().constData());
+      return 0;
+   }
+
+   // walk the chunks
+
+   for (unsigned int pos = 12; pos + 8 <= size; )
+   {
+      unsigned int chunkSize = p[pos+4] | p[pos+5] << 8 | p[pos+6] << 16 | p[pos+7] << 24;
+      const unsigned char* chunk = p + pos + 8;
+
+      chunkSize = qMin(chunkSize, size - pos - 8);
+
+      if (memcmp(p+pos, "fmt ", 4) == 0 && chunkSize >= 16)
+      {
+         memcpy(&format.wFormatTag, chunk, 16);
+         haveFormat = true;
+      }
+      else if (memcmp(p+pos, "data", 4) == 0)
+      {
+         data = chunk;
+         dataSize = chunkSize;
+      }
+
+      pos += 8 + chunkSize + (chunkSize & 1);
+   }
+
+   if (!haveFormat || !data || format.wFormatTag != 1
+       || (format.wBitsPerSample != 8 && format.wBitsPerSample != 16)
+       || !format.wChannels || !format.dwSamplesPerSec)
+   {
+      tell(eloAlways, "Bad format: '%s' is no 8/16 bit PCM wave", file.toAscii().constData());
+      return 0;
+   }
+
+   int bytes = format.wBitsPerSample / 8;
+   int srcFrames = dataSize / (bytes * format.wChannels);
+   int step = bytes * format.wChannels;
+   double ratio = format.dwSamplesPerSec / (double)rate;
+
+   clip = new Clip;
+   clip->file = file;
+   clip->frames = (int)(srcFrames / ratio);
+   clip->samples = (short*)malloc(clip->frames * channels * sizeof(short));
+
+   // resample linear
+
+   for (int i = 0; i < clip->frames; i++)
+   {
+      double srcPos = i * ratio;
+      int a = qMin((int)srcPos, srcFrames - 1);
+      int b = qMin(a + 1, srcFrames - 1);
+      double frac = srcPos - a;
+
+      for (int c = 0; c < channels; c++)
+      {
+         int ch = qMin(c, format.wChannels - 1);     // mono to both channels
+         const unsigned char* sa = data + a * step + ch * bytes;
+         const unsigned char* sb = data + b * step + ch * bytes;
+         int va, vb;
+
+         if (bytes == 1)
+         {
+            va = (sa[0] - 128) << 8;
+            vb = (sb[0] - 128) << 8;
+         }
+         else
+         {
+            va = (short)(sa[0] | sa[1] << 8);
+            vb = (short)(sb[0] | sb[1] << 8);
+         }
+
+         clip->samples[i * channels + c] = (short)(va + (vb - va) * frac);
+      }
+   }
+
+   tell(eloDetail, "Loaded '%s' (%d Hz, %d channel, %d bit) with %d frames",
+        file.toAscii().constData(), format.dwSamplesPerSec, format.wChannels,
+        format.wBitsPerSample, clip->frames);
+
+   return clip;
+}
+
 #ifdef ALSA_TEST
 
 //***************************************************************************
@@ -14,8 +14,12 @@
 
 #include <alsa/asoundlib.h>
 
+#include <sys/time.h>
+
 #include <QSound>
 #include <QThread>
+#include <QMutex>
+#include <QHash>
 
 //***************************************************************************
 // QAlsaSound
@@ -109,5 +113,82 @@ class QAlsaSound : public QThread
       static QList<QAlsaSound*> sounds;  // hold active static instances
 };
 
+//***************************************************************************
+// QAlsaPlayer
+//  - one long living playback thread, the pcm device stays open and is
+//    fed period by period, silence if nothing is playing
+//  - the clips are decoded once to S16 stereo 44.1kHz and kept in memory
+//  - the voices are mixed by saturating 16 bit adds, if all voices are
+//    busy the one with the lowest priority is stolen
+//***************************************************************************
+
+class QAlsaPlayer : public QThread
+{
+   public:
+
+      enum Misc
+      {
+         rate = 44100,
+         channels = 2,
+         periodFrames = 256,         // ~6ms
+         periods = 4,                // device buffer ~23ms
+         maxVoices = 8
+      };
+
+      struct Clip
+      {
+         QString file;
+         short* samples;             // interleaved stereo
+         int frames;
+      };
+
+      struct Voice
+      {
+         const Clip* clip;
+         int position;               // [frames]
+         int priority;               // higher wins if all voices are busy
+         timeval triggered;
+      };
+
+      // static interface
+
+      static int start();
+      static void stop();
+      static int isActive()          { return player != 0; }
+      static int preload(const QString& file);
+      static void play(const QString& file, int priority = 0);
+
+   protected:
+
+      QAlsaPlayer();
+      virtual ~QAlsaPlayer();
+
+      int openDevice();
+      void run();
+      void takePending();
+      int voiceFor(const Voice* voice);
+      void mix(short* buffer, int frames);
+
+      static Clip* decode(const QString& file);
+
+      // data
+
+      snd_pcm_t* handle;
+      bool running;
+
+      QMutex mutex;
+      QList<Voice> pending;          // triggered, not yet playing
+      Voice voices[maxVoices];       // used by the playback thread only
+
+      // latency statistic, trigger to audio
+
+      int latencyCount;
+      double latencySum;
+      double latencyMax;
+
+      static QAlsaPlayer* player;
+      static QHash<QString, Clip*> clips;
+};
+
 //***************************************************************************
 #endif
@@ -24,6 +24,7 @@
 #include <time.h>
 
 #include <arduino.hpp>
+#include <trace.hpp>
 
 //***************************************************************************
 // Object
@@ -306,6 +307,7 @@ int Arduino::initIoSetup(word bitsInput, word bitsOutput, byte withSpi)
       tell(eloAlways, "Initializing bord time failed!");
 
    recordGhostCar(na, na);                     // switch off ghostcar recording
+   recordTelemetry(0, 0, 0);                   // and race telemetry
 
    sio.bitsInput = bitsInput;
    sio.bitsOutput = bitsOutput;
@@ -387,8 +389,7 @@ int Arduino::writeBit(int bit, int state)
    if (!fdDevice || bit == na)
       return fail;
 
-   tell(eloDebug, "Debug: Write bit (%d) value (%d)",
-        bit, state);
+   TRACE(eloDebug, "Debug: Write bit (%d) value (%d)", bit, state);
 
    DigitalOutputBit digital;
    digital.bit = bit;
@@ -408,9 +409,7 @@ int Arduino::writeBit(int bit, int state)
 
 int Arduino::readOutBit(int bit)
 {
-   char buf[100+TB];
-
-   tell(eloDebug2, "Debug: out value is '%s'", toBinStr(outValue, buf));
+   TRACE(eloDebug2, "Debug: out value is '%32b'", outValue);
 
    return isBit(outValue, bit);
 }
@@ -450,6 +449,29 @@ void Arduino::recordGhostCar(char vBit, char iBit)
    }
 }
 
+//***************************************************************************
+// Record Telemetry
+//  - the volt and ampere input of each lane, cycle 0 -> off
+//***************************************************************************
+
+void Arduino::recordTelemetry(int cycle, const char* vBits, const char* iBits)
+{
+   if (fdDevice)
+   {
+      RecordTelemetry rt;
+
+      rt.cycle = cycle;
+
+      for (int lane = 0; lane < telemetryLanes; lane++)
+      {
+         rt.voltBit[lane] = cycle ? vBits[lane] : na;
+         rt.ampereBit[lane] = cycle ? iBits[lane] : na;
+      }
+
+      sendCommand(cRecordTelemetry, &rt, sizeof(RecordTelemetry));
+   }
+}
+
 //***************************************************************************
 // Start/Stop Ghost Car
 //***************************************************************************
@@ -521,7 +543,7 @@ int Arduino::look(byte& command)
    if (_look() != success)
       return ignore;           // no input data pending
 
-   tell(eloDebug2, "Debug: look() succeeded, reading command");
+   TRACE(eloDebug2, "Debug: look() succeeded, reading command");
 
    if ((cmd = receiveCommand()) == cNone)
       return fail;
@@ -545,7 +567,7 @@ int Arduino::sendCommand(byte command, void* line, byte size)
       return done;
    }
 
-   tell(eloDebug2, "-> (0x%x)", command);
+   TRACE(eloDebug2, "-> (0x%x)", command);
 
    // byte cmd = protocol | (command & commandMask);
 
@@ -656,8 +678,8 @@ byte Arduino::receiveCommand()
       usleep(100);
    }
 
-   tell(eloDebug, "Debug: Got command (0x%X) expected size is (%d)",
-        command, messageSize);
+   TRACE(eloDebug, "Debug: Got command (0x%X) expected size is (%d)",
+         command, messageSize);
 
    // get message
 
@@ -665,7 +687,7 @@ byte Arduino::receiveCommand()
    {
       res = read(message+count, messageSize-count);
 
-      tell(eloDebug2, "Debug: read() result was (%d)", res);
+      TRACE(eloDebug2, "Debug: read() result was (%d)", res);
 
       if (res <= 0)
          usleep(100);
@@ -676,7 +698,7 @@ byte Arduino::receiveCommand()
 //    for (int i = 0; i < count; i++)
 //       tell(eloDebug2, "Debug: got byte (0x%d)", message[i]);
 
-   tell(eloDebug2, "Debug: read() (%d) bytes", count);
+   TRACE(eloDebug2, "Debug: read() (%d) bytes", count);
 
    return command;
 }
@@ -50,6 +50,7 @@ class Arduino : public IoInterface, public SlotService
       virtual int isOpen()              { return fdDevice != 0 && opened; }
       virtual int connected();
       virtual int flush();
+      virtual int getGcScale()          { return gcScale20; }
       virtual int look(byte& command);
       virtual byte* getMessage()        { if (*message) return message; return 0; };
       virtual byte getMessageSize()     { return messageSize; };
@@ -61,6 +62,7 @@ class Arduino : public IoInterface, public SlotService
       virtual void stopGhostCar();
       virtual void writeGhostCarValue(byte volt, byte ampere);
       virtual void flushGhostCar();
+      virtual void recordTelemetry(int cycle, const char* vBits, const char* iBits);
       virtual int initIoSetup(word bitsInput, word bitsOutput, byte withSpi);
 
       // read / write
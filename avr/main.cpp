@@ -245,6 +245,92 @@ class FifoCache
       Node* last;
 };
 
+//***************************************************************************
+// class GcBlockEncoder
+//   collect the ghost car samples as delta/RLE coded block
+//   (token layout see Ios::GhostCarCoding)
+//***************************************************************************
+
+class GcBlockEncoder
+{
+   public:
+
+      GcBlockEncoder()  { reset(); }
+
+      // interface
+
+      void reset()      { block.count = 0; size = 0; runAt = na; }
+      byte count()      { return block.count; }
+      byte frameSize()  { return 3 + size; }
+      const byte* frame()  { return (const byte*)&block; }
+
+      // returns fail if the sample don't fit in the block anymore
+
+      int add(byte volt, byte ampere)
+      {
+         if (!block.count)
+         {
+            block.volt = volt;
+            block.ampere = ampere;
+         }
+         else
+         {
+            int dv = (int)volt - (int)lastVolt;
+            int da = (int)ampere - (int)lastAmpere;
+
+            if (block.count == 0xFF)
+               return fail;
+
+            if (!dv && !da && runAt != na && (block.data[runAt] & Ios::gccRunMax) < Ios::gccRunMax)
+            {
+               block.data[runAt]++;
+            }
+            else if (!dv && !da)
+            {
+               if (size + 1 > Ios::sizeGcBlockData)
+                  return fail;
+
+               runAt = size;
+               block.data[size++] = Ios::gccRun;
+            }
+            else if (dv >= -8 && dv <= 7 && da >= -4 && da <= 3)
+            {
+               if (size + 1 > Ios::sizeGcBlockData)
+                  return fail;
+
+               runAt = na;
+               block.data[size++] = ((dv + 8) << 3) | (da + 4);
+            }
+            else
+            {
+               if (size + 3 > Ios::sizeGcBlockData)
+                  return fail;
+
+               runAt = na;
+               block.data[size++] = Ios::gccAbsolute;
+               block.data[size++] = volt;
+               block.data[size++] = ampere;
+            }
+         }
+
+         lastVolt = volt;
+         lastAmpere = ampere;
+         block.count++;
+
+         return success;
+      }
+
+   private:
+
+      // data
+
+      Ios::GhostCarBlock block;
+      byte size;
+      int runAt;
+      byte lastVolt;
+      byte lastAmpere;
+};
+
 //**************************************************************
 // Globals
 //**************************************************************
@@ -259,7 +345,12 @@ unsigned int outputValue = 0;                 // value for output via shift-regi
 
 char ghostcarPinU = na;
 char ghostcarPinI = na;
-char gcScaleLoad = 100;
+char gcScaleLoad = 20;
+GcBlockEncoder gcRecordBlock;                 // block actually recorded
+GcBlockEncoder gcSendBlock;                   // block waiting for send
+byte gcSendPending = false;
+byte gcSendEnd = false;                       // send 'end of recording' block
+word gcDroppedBlocks = 0;                     // blocks lost while the sender was busy
 char gcControlScaleLoad = 10;
 char gcPwmOut = na;
 byte gcMode = gcmOff;
@@ -271,12 +362,27 @@ byte decFactor = 5;
 word bitsInput = 0;
 word bitsOutput = 0;
 
+struct TelemetryLane
+{
+   GcBlockEncoder encoder;                    // block actually recorded
+   unsigned long time;                        // board time of its first sample
+};
+
+char tmScaleLoad = 0;                         // race telemetry cycle, 0 -> off
+char tmPinU[Ios::telemetryLanes];
+char tmPinI[Ios::telemetryLanes];
+TelemetryLane tmLanes[Ios::telemetryLanes];
+Ios::TelemetryBlock tmSendBlock;              // block waiting for send
+byte tmSendSize = 0;                          // its frame size, 0 -> nothing pending
+
 //***************************************************************************
 // Prototypes
 //***************************************************************************
 
 unsigned char setupTimer2();
 void setupSpiBus();
+void gcFlushRecordBlock();
+int tmFlushLane(byte lane, byte force);
 
 //**************************************************************
 // Setup
@@ -432,10 +538,19 @@ void meanwhile()
          if (ghostcarPinI != na)
             ampere = analogRead(ghostcarPinI);
 
-         if (!inputCache.full())
-            inputCache.push(volt, ampere, Ios::cAnalogIn);
+         // block full or due -> hand over to sendPengingIo()
+
+         if (gcRecordBlock.add(volt, ampere) != success)
+         {
+            gcFlushRecordBlock();
+            gcRecordBlock.add(volt, ampere);
+         }
+         else if (gcRecordBlock.count() >= Ios::gcBlockSamples)
+         {
+            gcFlushRecordBlock();
+         }
 
-         gcScale = gcScaleLoad;
+         gcScale = gcScaleLoad - 1;
       }
    }
    else if (gcMode == gcmReplay)
@@ -465,7 +580,7 @@ void meanwhile()
 
          gcBufferTail = (gcBufferTail + 1) % sizeGcBuffer;
 
-         gcScale = gcScaleLoad;
+         gcScale = gcScaleLoad - 1;
       }
 
       else if (gcControlScaleLoad != na && !gcControlScale--)
@@ -506,6 +621,44 @@ void meanwhile()
       }
    }
 
+   // race telemetry, all configured lanes
+
+   static char tmScale = 0;
+
+   if (tmScaleLoad && !tmScale--)
+   {
+      for (byte lane = 0; lane < Ios::telemetryLanes; lane++)
+      {
+         if (tmPinU[lane] == na)
+            continue;
+
+         GcBlockEncoder* encoder = &tmLanes[lane].encoder;
+         byte volt = (analogRead(tmPinU[lane]) * 255L) / 1024L;
+         byte ampere = 0;
+
+         if (tmPinI[lane] != na)
+            ampere = (analogRead(tmPinI[lane]) * 255L) / 1024L;
+
+         if (!encoder->count())
+            tmLanes[lane].time = lastMsec;
+
+         // block full -> hand over, due -> hand over if the sender is free
+
+         if (encoder->add(volt, ampere) != success)
+         {
+            tmFlushLane(lane, true);
+            tmLanes[lane].time = lastMsec;
+            encoder->add(volt, ampere);
+         }
+         else if (encoder->count() >= Ios::gcBlockSamples)
+         {
+            tmFlushLane(lane, false);
+         }
+      }
+
+      tmScale = tmScaleLoad - 1;
+   }
+
 #endif
 
    // check io state's
@@ -591,6 +744,63 @@ void meanwhile()
    // digitalWrite(7, LOW);             // to messure the length
 }
 
+//**************************************************************
+// Flush Ghost Car Record Block
+//   hand over the actual block to the sender,
+//   if the last one is still pending the samples are lost,
+//   the lost blocks are reported at the end of the recording
+//**************************************************************
+
+void gcFlushRecordBlock()
+{
+   if (!gcRecordBlock.count())
+      return ;
+
+   if (!gcSendPending)
+   {
+      gcSendBlock = gcRecordBlock;
+      gcSendPending = true;
+   }
+   else
+   {
+      gcDroppedBlocks++;
+   }
+
+   gcRecordBlock.reset();
+}
+
+//**************************************************************
+// Flush Telemetry Lane
+//   hand over the block of the lane to the sender, if the sender
+//   is busy the lane keeps recording, unless 'force' (block full)
+//   then the samples are lost
+//**************************************************************
+
+int tmFlushLane(byte lane, byte force)
+{
+   GcBlockEncoder* encoder = &tmLanes[lane].encoder;
+
+   if (!encoder->count())
+      return success;
+
+   if (tmSendSize)
+   {
+      if (force)
+         encoder->reset();
+
+      return fail;
+   }
+
+   tmSendBlock.lane = lane + 1;
+   tmSendBlock.time = tmLanes[lane].time;
+   memcpy(&tmSendBlock.block, encoder->frame(), encoder->frameSize());
+   tmSendSize = sizeof(Ios::TelemetryBlock) - sizeof(Ios::GhostCarBlock) + encoder->frameSize();
+
+   encoder->reset();
+
+   return success;
+}
+
 //**************************************************************
 // Send Pending IO
 //**************************************************************
@@ -599,6 +809,25 @@ void sendPengingIo()
 {
    IoValue v;
 
+   if (gcSendPending)
+   {
+      sendCommand(Ios::cGhostCarBlock, gcSendBlock.frame(), gcSendBlock.frameSize());
+      gcSendPending = false;
+   }
+
+   if (gcSendEnd && !gcSendPending)
+   {
+      gcSendBlock.reset();
+      sendCommand(Ios::cGhostCarBlock, gcSendBlock.frame(), gcSendBlock.frameSize());
+      gcSendEnd = false;
+   }
+
+   if (tmSendSize)
+   {
+      sendCommand(Ios::cTelemetryBlock, (const byte*)&tmSendBlock, tmSendSize);
+      tmSendSize = 0;
+   }
+
    while (inputCache.count())
    {
       meanwhile();
@@ -711,7 +940,18 @@ void cmdRecordGhostCar(const byte* buffer)
 
    memcpy(&rgc, buffer, sizeof(Ios::RecordGhostCar));
 
-   gcScaleLoad = rgc.cycle;     // should at least 100ms !
+   // stop of a running recording -> flush last block and send end marker
+
+   if (gcMode == gcmRecord && rgc.voltBit == na)
+   {
+      gcFlushRecordBlock();
+      gcSendEnd = true;
+
+      if (gcDroppedBlocks)
+         debug("GC record blocks dropped", gcDroppedBlocks);
+   }
+
+   gcScaleLoad = rgc.cycle;     // 10-20ms, samples are sent as coded blocks
 
    ghostcarPinU = rgc.voltBit;
    ghostcarPinI = rgc.ampereBit;
@@ -719,7 +959,11 @@ void cmdRecordGhostCar(const byte* buffer)
    gcMode = ghostcarPinU != na ? gcmRecord : gcmOff;
 
    if (gcMode == gcmRecord)
+   {
       inputCache.flush();
+      gcRecordBlock.reset();
+      gcDroppedBlocks = 0;
+   }
 }
 
 //**************************************************************
@@ -784,6 +1028,27 @@ void cmdGhostCarFlush()
    gcBufferTail = gcBufferHead = 0;
 }
 
+//**************************************************************
+// Command 'Record - Telemetry'
+//   cycle 0 stops, a block not sent yet is dropped
+//**************************************************************
+
+void cmdRecordTelemetry(const byte* buffer)
+{
+   Ios::RecordTelemetry rt;
+
+   memcpy(&rt, buffer, sizeof(Ios::RecordTelemetry));
+
+   tmScaleLoad = rt.cycle;
+
+   for (byte lane = 0; lane < Ios::telemetryLanes; lane++)
+   {
+      tmPinU[lane] = rt.cycle ? rt.voltBit[lane] : na;
+      tmPinI[lane] = rt.cycle ? rt.ampereBit[lane] : na;
+      tmLanes[lane].encoder.reset();
+   }
+}
+
 //***************************************************************************
 // Command 'Setup IO'
 //***************************************************************************
@@ -886,12 +1151,13 @@ void loop()
          case Ios::cStopGhostCar:   cmdStopGhostCar();       break;
          case Ios::cSetupIo:        cmdSetupIo(line);        break;
          case Ios::cGhostCarFlush:  cmdGhostCarFlush();      break;
+         case Ios::cRecordTelemetry: cmdRecordTelemetry(line); break;
       }
    }
 
-   // Digital IO
+   // Digital IO and ghost car blocks
 
-   if (inputCache.count())
+   if (inputCache.count() || gcSendPending || gcSendEnd || tmSendSize)
       sendPengingIo();
 }
 
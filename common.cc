@@ -26,6 +26,8 @@
 #include <QMessageBox>
 
 #include <common.hpp>
+#include <logger.hpp>
+#include <trace.hpp>
 
 //***************************************************************************
 // Globals
@@ -41,39 +43,77 @@ int withSound;
 
 int tell(int eloquence, const char* format, ...)
 {
-   const int sizeDate = 8;        // "12.04.67"
-   const int sizeTime = 8;        // "12:12:34"
-   const int sizeDateTime = sizeDate + 1 + sizeTime;
-   const int sizeMSec = 4;        // ",142"
-   const int sizeHeader = sizeDateTime + sizeMSec + 1;
+   va_list ap;
+
+   if (theEloquence < eloquence)
+      return 0;
+
+   va_start(ap, format);
+   vtell(format, ap);
+   va_end(ap);
+
+   return 0;
+}
+
+//***************************************************************************
+// Tell Trace
+//  - fallback of TRACE() if no trace file is open, the format may
+//    contain the trace conversions like '%32b'
+//***************************************************************************
+
+int tellTrace(int eloquence, const char* format, ...)
+{
    const int maxBuf = 1000;
 
-   struct timeval tp;
+   Trace::Format f;
+   Trace::Record r;
    char buf[maxBuf+TB];
    va_list ap;
-   time_t now;
+
+   if (theEloquence < eloquence)
+      return 0;
+
+   f.argc = Trace::parseFormat(format, f.types);
+   strncpy(f.format, format, Trace::sizeFormat);
+   f.format[Trace::sizeFormat-1] = 0;
 
    va_start(ap, format);
+   r.slotCount = Trace::pack(&f, &r, ap);
+   va_end(ap);
 
-   if (theEloquence >= eloquence)
-   {
-      time(&now);
-      gettimeofday(&tp, 0);
+   Trace::render(&f, &r, buf, maxBuf);
 
-      vsnprintf(buf + sizeHeader, maxBuf - sizeHeader, format, ap);
-      strftime(buf, sizeDateTime+1, "%y.%m.%d %H:%M:%S", localtime(&now));
+   return tell(eloquence, "%s", buf);
+}
 
-      sprintf(buf+sizeDateTime, ",%3.3ld", tp.tv_usec / 1000);
+//***************************************************************************
+// V Tell
+//  - if the log writer is running the message is only queued, otherwise
+//    it's written synchronous
+//***************************************************************************
 
-      buf[sizeHeader-1] = ' ';
+int vtell(const char* format, va_list ap)
+{
+   const int maxBuf = Logger::maxMessage + 50;
 
-      if (logFile.size())
-         tellFile(buf);
-      else
-         printf("%s\n", buf);
-   }
+   struct timeval tp;
+   char msg[Logger::maxMessage+TB];
+   char buf[maxBuf+TB];
 
-   va_end(ap);
+   // on overflow the message is counted as dropped,
+   // if the writer is just stopping we log synchronous
+
+   if (Logger::isActive() && Logger::push(format, ap) == success)
+      return 0;
+
+   gettimeofday(&tp, 0);
+   vsnprintf(msg, Logger::maxMessage, format, ap);
+   Logger::format(buf, maxBuf, &tp, msg);
+
+   if (logFile.size())
+      tellFile(buf);
+   else
+      printf("%s\n", buf);
 
    return 0;
 }
@@ -99,12 +139,12 @@ void tellFile(const char* msg)
 // Play Sound
 //***************************************************************************
 
-void playSound(QString file)
+void playSound(QString file, int priority)
 {
    if (withSound)
    {
 #ifndef Q_OS_WIN32
-      QAlsaSound::play(file);
+      QAlsaPlayer::play(file, priority);
 #else
       QSound::play(file);
 #endif
@@ -120,7 +160,7 @@ void checkSound()
 #ifdef Q_OS_WIN32
    withSound = QSound::isAvailable();
 #else
-   withSound = QAlsaSound::isAvailable();
+   withSound = QAlsaPlayer::start() == success;
 #endif
 
    if (!withSound)
@@ -481,16 +521,18 @@ const char* SlotService::analogInFunctionName(int fct)
 
 SlotService::SoundSignal SlotService::sounds[] =
 {
-   { "Race start",          "explos.wav"   },
-   { "Race finished",       "left.wav"     },
-   { "Race aborted",        "applause.wav" },
-   { "Countdown phase",     "pluck.wav"    },
-   { "Lap signal",          "notify.wav"   },
-   { "Fueling start",       "pass.wav"     },
-   { "Fueling interrupted", "coin.wav"     },
-   { "Fueling finished",    "coin.wav"     },
-   { "'Jump the gun'",      "send.wav"     },
-   { "Fuel empty",          "skid.wav"     }
+   // name, default sound, priority
+
+   { "Race start",          "explos.wav",   3 },
+   { "Race finished",       "left.wav",     3 },
+   { "Race aborted",        "applause.wav", 3 },
+   { "Countdown phase",     "pluck.wav",    2 },
+   { "Lap signal",          "notify.wav",   0 },
+   { "Fueling start",       "pass.wav",     1 },
+   { "Fueling interrupted", "coin.wav",     1 },
+   { "Fueling finished",    "coin.wav",     1 },
+   { "'Jump the gun'",      "send.wav",     2 },
+   { "Fuel empty",          "skid.wav",     2 }
 };
 
 //***************************************************************************
@@ -21,6 +21,7 @@
 #endif
 
 #include <time.h>
+#include <stdarg.h>
 
 #ifdef Q_OS_WIN32
 
@@ -78,8 +79,9 @@ extern int withSound;
 
 int tell(int eloquence, const char* format, ...);
 int tell(const char* format, ...);
+int vtell(const char* format, va_list ap);
 void tellFile(const char* msg);
-void playSound(QString file);
+void playSound(QString file, int priority = 0);
 void checkSound();
 
 const char* notNull(const char* s);
@@ -258,6 +260,15 @@ class SlotService
          byte ampere;
       };
 
+      struct TelemetryEvent
+      {
+         int slot;
+         timeval tp;                // first sample
+         int count;
+         byte volt[255];
+         byte ampere[255];
+      };
+
       struct Led
       {
          int id;
@@ -268,6 +279,7 @@ class SlotService
       {
          const char* name;
          QString sound;
+         int priority;                // higher may steal the voice of lower
       };
 
       // bit manipulation
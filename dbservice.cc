@@ -0,0 +1,1079 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File dbservice.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <QMetaType>
+
+#include <common.hpp>
+#include <dbservice.hpp>
+#include <laptelemetry.hpp>
+
+//***************************************************************************
+// Class DbJob
+//***************************************************************************
+
+DbJob::DbJob()
+{
+   status = success;
+   urgent = no;
+   owned = no;
+   ownTransaction = no;
+   done = no;
+   latency = 0;
+   member = 0;
+   SlotService::tvNull(&queued);
+}
+
+DbJob::~DbJob()
+{
+}
+
+//***************************************************************************
+// Class DbQuery
+//***************************************************************************
+
+DbQuery::DbQuery(const char* aSql)
+   : DbJob()
+{
+   sql = aSql;
+   insertRowId = 0;
+}
+
+//***************************************************************************
+// Execute
+//***************************************************************************
+
+int DbQuery::execute(SqliteDb* db)
+{
+   SqliteDb::Statement* stmt;
+   int rc;
+   int cols;
+
+   names.clear();
+   rows.clear();
+
+   if (!(stmt = db->getStatement(sql.constData())))
+      return fail;
+
+   for (int i = 0; i < params.size(); i++)
+   {
+      const QVariant& p = params.at(i);
+
+      if (p.isNull())
+         db->bindNull(stmt, i+1);
+      else if (p.type() == QVariant::Double)
+         db->bindDouble(stmt, i+1, p.toDouble());
+      else if (p.type() == QVariant::Int || p.type() == QVariant::LongLong
+               || p.type() == QVariant::UInt || p.type() == QVariant::Bool)
+         db->bindInt64(stmt, i+1, p.toLongLong());
+      else
+         db->bindText(stmt, i+1, p.toString().toAscii().constData());
+   }
+
+   cols = sqlite3_column_count(stmt);
+
+   for (int col = 0; col < cols; col++)
+      names << sqlite3_column_name(stmt, col);
+
+   while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+   {
+      QList<QVariant> row;
+
+      for (int col = 0; col < cols; col++)
+      {
+         switch (sqlite3_column_type(stmt, col))
+         {
+            case SQLITE_INTEGER: row << (qlonglong)sqlite3_column_int64(stmt, col);  break;
+            case SQLITE_FLOAT:   row << sqlite3_column_double(stmt, col);            break;
+            case SQLITE_NULL:    row << QVariant();                                  break;
+            default:             row << QString((const char*)sqlite3_column_text(stmt, col));
+         }
+      }
+
+      rows << row;
+   }
+
+   insertRowId = db->getInsertRowId();
+   db->reset(stmt);
+
+   if (rc != SQLITE_DONE)
+   {
+      tell(eloAlways, "Error: Statement '%s' failed, %s (%d)",
+           sql.constData(), db->lastError(), rc);
+      return fail;
+   }
+
+   return success;
+}
+
+//***************************************************************************
+// Class RaceJob
+//  - the race and its laps, executed by DbService::executeRace()
+//***************************************************************************
+
+class DbService::RaceJob : public DbJob
+{
+   public:
+
+      enum Type
+      {
+         rjStart,
+         rjLap,
+         rjTelemetry,
+         rjFinished,
+         rjAborted,
+         rjRecover,
+         rjRebuild
+      };
+
+      RaceJob(DbService* aService, int aType)
+         : DbJob()
+      {
+         service = aService;
+         type = aType;
+         slot = na;
+         lap = 0;
+         usec = 0;
+         laps = 0;
+         lapLength = 0;
+         time = 0;
+         start = 0;
+         cycle = 0;
+      }
+
+      int execute(SqliteDb*)     { return service->executeRace(this); }
+
+      DbService* service;
+      int type;
+      int slot;
+      int lap;
+      long long usec;
+      int laps;
+      double lapLength;
+      time_t time;
+      QString driver[2];
+      QString car[2];
+      QString course;
+      long long start;
+      int cycle;
+      QByteArray volts;
+      QByteArray amperes;
+};
+
+//***************************************************************************
+// Object
+//***************************************************************************
+
+DbService::DbService(const char* aPath)
+   : QThread()
+{
+   path = strdup(aPath);
+   db = 0;
+   store = 0;
+   storeReader = 0;
+   running = no;
+   urgentJobs = 0;
+   maxQueueDepth = 0;
+   jobCount = 0;
+   latencySum = 0;
+   maxLatency = 0;
+   raceId = na;
+   driverIds[0] = driverIds[1] = na;
+
+   qRegisterMetaType<DbJob*>("DbJob*");
+
+   connect(this, SIGNAL(resultsReady()), this, SLOT(onResultsReady()),
+           Qt::QueuedConnection);
+}
+
+DbService::~DbService()
+{
+   close();
+   free(path);
+}
+
+//***************************************************************************
+// Open / Close
+//***************************************************************************
+
+int DbService::open()
+{
+   if (db)
+      return done;
+
+   db = new SqliteDb(path);
+
+   if (db->open() != success)
+   {
+      tell(eloAlways, "Error: Open database '%s' failed", path);
+      delete db;
+      db = 0;
+
+      return fail;
+   }
+
+   // WAL: the writes don't block the readers
+   // FULL: the WAL is synced with each commit, else the last commits may be
+   //  lost on power loss - the laps are committed in batches, so it's one
+   //  sync per batch and done by this thread, not by the GUI
+
+   db->execute("PRAGMA journal_mode=WAL;");
+   db->execute("PRAGMA synchronous=FULL;");
+   db->execute("PRAGMA busy_timeout=2000;");
+
+   running = yes;
+   start(QThread::LowPriority);
+
+   return success;
+}
+
+void DbService::close()
+{
+   if (!db)
+      return ;
+
+   // the thread executes all pending jobs before it ends
+
+   mutex.lock();
+   running = no;
+   jobsPending.wakeAll();
+   mutex.unlock();
+
+   wait();
+
+   // results the GUI didn't take anymore, the event is dropped if
+   // the event loop is already gone
+
+   mutex.lock();
+
+   if (results.size())
+      tell(eloDetail, "DbService: Dropping (%d) undelivered results", results.size());
+
+   qDeleteAll(results);
+   results.clear();
+   mutex.unlock();
+
+   delete store;                     // writes the blocks still queued
+   store = 0;
+   delete storeReader;
+   storeReader = 0;
+
+   tell(eloAlways, "DbService: (%ld) jobs, latency avg (%lld) max (%lld) ms, max queue depth (%d)",
+        jobCount, getLatency() / 1000, maxLatency / 1000, maxQueueDepth);
+
+   delete db;
+   db = 0;
+}
+
+//***************************************************************************
+// Open Store
+//  - the telemetry goes to the time series store from now on,
+//    call it before the first race
+//***************************************************************************
+
+int DbService::openStore(const char* storePath)
+{
+   TsWriter* writer;
+
+   if (!db || store)
+      return done;
+
+   writer = new TsWriter(storePath);
+
+   if (writer->open() != success)
+   {
+      tell(eloAlways, "Error: Open time series store '%s' failed, "
+           "keeping the telemetry in the database", storePath);
+      delete writer;
+
+      return fail;
+   }
+
+   store = writer;
+
+   // the reader maps the blocks written meanwhile by refresh()
+
+   storeReader = new TsReader();
+   storeReader->open(storePath);
+
+   return success;
+}
+
+//***************************************************************************
+// Submit
+//  - the job is owned by the service from now on
+//***************************************************************************
+
+void DbService::submit(DbJob* job, QObject* receiver, const char* member)
+{
+   if (!db)
+   {
+      delete job;
+      return ;
+   }
+
+   job->owned = yes;
+   job->receiver = receiver;
+   job->member = member;
+   job->urgent = receiver != 0;
+
+   enqueue(job);
+}
+
+//***************************************************************************
+// Call
+//  - blocks until the job is committed, the job is owned by the caller
+//***************************************************************************
+
+int DbService::call(DbJob* job)
+{
+   if (!db)
+      return fail;
+
+   job->owned = no;
+   job->urgent = yes;
+
+   enqueue(job);
+
+   QMutexLocker locker(&mutex);
+
+   while (!job->done)
+      jobsDone.wait(&mutex);
+
+   return job->status;
+}
+
+void DbService::enqueue(DbJob* job)
+{
+   QMutexLocker locker(&mutex);
+
+   SlotService::tvNow(&job->queued);
+   job->done = no;
+   jobs.append(job);
+
+   if (job->urgent)
+      urgentJobs++;
+
+   maxQueueDepth = qMax(maxQueueDepth, jobs.size());
+   jobsPending.wakeOne();
+}
+
+int DbService::getQueueDepth()
+{
+   QMutexLocker locker(&mutex);
+
+   return jobs.size();
+}
+
+//***************************************************************************
+// On Results Ready
+//  - GUI thread, deliver the results of the submitted jobs, the jobs are
+//    taken one by one since a receiver may run a local event loop
+//***************************************************************************
+
+void DbService::onResultsReady()
+{
+   for (;;)
+   {
+      DbJob* job;
+
+      mutex.lock();
+      job = results.isEmpty() ? 0 : results.takeFirst();
+      mutex.unlock();
+
+      if (!job)
+         break;
+
+      if (job->receiver && job->member)
+         QMetaObject::invokeMethod(job->receiver, job->member,
+                                   Qt::DirectConnection, Q_ARG(DbJob*, job));
+
+      delete job;
+   }
+}
+
+//***************************************************************************
+// Run
+//  - wait up to 'commitInterval' to group the writes, then execute all
+//    queued jobs in one transaction
+//***************************************************************************
+
+void DbService::run()
+{
+   QList<DbJob*> batch;
+   int submitted;
+   timeval start, now;
+   long long left;
+   int inTransaction;
+
+   for (;;)
+   {
+      mutex.lock();
+
+      while (running && jobs.isEmpty())
+         jobsPending.wait(&mutex);
+
+      SlotService::tvNow(&start);
+
+      while (running && !urgentJobs
+             && (left = commitInterval - SlotService::elapsed(&start, SlotService::tvNow(&now)) / 1000) > 0)
+         jobsPending.wait(&mutex, left);
+
+      batch = jobs;
+      jobs.clear();
+      urgentJobs = 0;
+      mutex.unlock();
+
+      if (batch.isEmpty())
+         break;                      // stopped and nothing left
+
+      // execute
+
+      SlotService::tvNow(&start);
+      inTransaction = no;
+
+      for (int i = 0; i < batch.size(); i++)
+      {
+         DbJob* job = batch.at(i);
+
+         if (job->ownTransaction && inTransaction)
+         {
+            db->execute("COMMIT;");
+            inTransaction = no;
+         }
+         else if (!job->ownTransaction && !inTransaction)
+         {
+            db->execute("BEGIN;");
+            inTransaction = yes;
+         }
+
+         job->status = job->execute(db);
+      }
+
+      if (inTransaction)
+         db->execute("COMMIT;");
+
+      SlotService::tvNow(&now);
+
+      // statistic, wake the callers
+
+      submitted = no;
+      mutex.lock();
+
+      for (int i = 0; i < batch.size(); i++)
+      {
+         DbJob* job = batch.at(i);
+
+         job->latency = SlotService::elapsed(&job->queued, &now);
+         latencySum += job->latency;
+         maxLatency = qMax(maxLatency, job->latency);
+         jobCount++;
+
+         if (job->owned)
+         {
+            results.append(job);
+            submitted = yes;
+         }
+
+         job->done = yes;            // a called job may be gone from now on
+      }
+
+      jobsDone.wakeAll();
+      mutex.unlock();
+
+      long long duration = SlotService::elapsed(&start, &now) / 1000;
+
+      tell(duration > slowBatch ? eloAlways : eloDebug,
+           "DbService: (%d) jobs committed in (%lld) ms, queue depth (%d)",
+           batch.size(), duration, getQueueDepth());
+
+      // deliver the results to the GUI thread
+
+      if (submitted)
+         emit resultsReady();
+   }
+}
+
+//***************************************************************************
+// Race Interface
+//  - called by the GUI, only queue the job
+//***************************************************************************
+
+void DbService::raceStarted(const char* driver1, const char* driver2,
+                            const char* car1, const char* car2,
+                            int laps, double lapLength, const char* course)
+{
+   RaceJob* job = new RaceJob(this, RaceJob::rjStart);
+
+   job->driver[0] = driver1;
+   job->driver[1] = driver2;
+   job->car[0] = car1;
+   job->car[1] = car2;
+   job->laps = laps;
+   job->lapLength = lapLength;
+   job->course = course;
+   job->time = ::time(0);
+
+   submit(job);
+}
+
+void DbService::lapDone(int slot, int lap, long long usec)
+{
+   RaceJob* job = new RaceJob(this, RaceJob::rjLap);
+
+   job->slot = slot;
+   job->lap = lap;
+   job->usec = usec;
+
+   submit(job);
+}
+
+void DbService::telemetryDone(int slot, int lap, long long start, int cycle,
+                              const QByteArray& volts, const QByteArray& amperes)
+{
+   RaceJob* job = new RaceJob(this, RaceJob::rjTelemetry);
+
+   job->slot = slot;
+   job->lap = lap;
+   job->start = start;
+   job->cycle = cycle;
+   job->volts = volts;
+   job->amperes = amperes;
+
+   submit(job);
+}
+
+void DbService::raceFinished()
+{
+   submit(new RaceJob(this, RaceJob::rjFinished));
+}
+
+void DbService::raceAborted()
+{
+   submit(new RaceJob(this, RaceJob::rjAborted));
+}
+
+int DbService::recover()
+{
+   RaceJob job(this, RaceJob::rjRecover);
+
+   return call(&job);
+}
+
+int DbService::rebuildRecords()
+{
+   RaceJob job(this, RaceJob::rjRebuild);
+
+   return call(&job);
+}
+
+//***************************************************************************
+// Execute Race
+//  - service thread
+//***************************************************************************
+
+int DbService::executeRace(RaceJob* job)
+{
+   SqliteDb::Statement* stmt = 0;
+
+   switch (job->type)
+   {
+      case RaceJob::rjStart:
+      {
+         for (int s = 0; s < 2; s++)
+         {
+            lapIds[s].clear();
+            driverIds[s] = driverIdOf(job->driver[s]);
+
+            keys[s].driverId = driverIds[s];
+            keys[s].car = job->car[s];
+            keys[s].course = job->course;
+            keys[s].lapLength = job->lapLength;
+         }
+
+         if (!(stmt = db->getStatement("INSERT INTO races(DRIVER1,DRIVER2,DATE,LAPS,LAP_LENGTH,COURSE,STATE,CAR1,CAR2) "
+                                       "VALUES(?,?,datetime(?, 'unixepoch', 'utc'),?,?,?,?,?,?);")))
+            return fail;
+
+         db->bindInt(stmt,    1, driverIds[0]);
+         db->bindInt(stmt,    2, driverIds[1]);
+         db->bindInt64(stmt,  3, job->time);
+         db->bindInt(stmt,    4, job->laps);
+         db->bindDouble(stmt, 5, job->lapLength);
+         db->bindText(stmt,   6, job->course.toAscii().constData());
+         db->bindInt(stmt,    7, rsRunning);
+         db->bindText(stmt,   8, job->car[0].toAscii().constData());
+         db->bindText(stmt,   9, job->car[1].toAscii().constData());
+
+         if (db->step(stmt) != success)
+         {
+            tell(eloAlways, "Error: Storing race failed, %s", db->lastError());
+            raceId = na;
+            break;
+         }
+
+         raceId = db->getInsertRowId();
+         tell(eloDetail, "Race (%d) started", raceId);
+
+         break;
+      }
+
+      case RaceJob::rjLap:
+      {
+         if (raceId == na || job->slot < 0 || job->slot > 1)
+            return ignore;
+
+         if (!(stmt = db->getStatement("INSERT INTO laps(RACE_ID,DRIVER_NR,LAP_NR,LAP_TIME,SLOT) "
+                                       "VALUES(?,?,?,?,?);")))
+            return fail;
+
+         db->bindInt(stmt,   1, raceId);
+         db->bindInt(stmt,   2, driverIds[job->slot]);
+         db->bindInt(stmt,   3, job->lap);
+         db->bindInt64(stmt, 4, job->usec);
+         db->bindInt(stmt,   5, job->slot);
+
+         if (db->step(stmt) != success)
+         {
+            tell(eloAlways, "Error: Storing lap failed, %s", db->lastError());
+            break;
+         }
+
+         db->reset(stmt);
+         stmt = 0;
+
+         // the telemetry of the lap follows, the same driver may race in both slots
+
+         lapIds[job->slot].insert(job->lap, db->getInsertRowId());
+         updateRecord(job->slot, db->getInsertRowId(), job->usec, job->lap == 1);
+
+         break;
+      }
+
+      case RaceJob::rjTelemetry:
+      {
+         long long lapId = na;
+
+         if (raceId == na || job->slot < 0 || job->slot > 1)
+            return ignore;
+
+         // the lap is queued before its telemetry, coding is done here
+         // (or by the store's writer) to keep it out of the gui thread
+
+         lapId = lapIds[job->slot].value(job->lap, na);
+         lapIds[job->slot].remove(job->lap);
+
+         if (lapId == na)
+         {
+            tell(eloDetail, "Telemetry of lap %d (slot %d) without lap, skipping", job->lap, job->slot);
+            return ignore;
+         }
+
+         if (store)
+         {
+            TsStore::Series* series = new TsStore::Series;
+
+            series->raceId = raceId;
+            series->slot = job->slot;
+            series->lap = job->lap;
+            series->channels = 2;
+
+            for (int i = 0; i < job->volts.size(); i++)
+            {
+               series->times.append(job->start + i * job->cycle * 1000LL);
+               series->values[0].append((byte)job->volts.at(i));
+               series->values[1].append((byte)job->amperes.at(i));
+            }
+
+            store->append(series);
+
+            break;
+         }
+
+         QByteArray volts = TelemetryCodec::encode(job->volts);
+         QByteArray amperes = TelemetryCodec::encode(job->amperes);
+
+         if (!(stmt = db->getStatement("INSERT INTO lap_telemetry(LAP_ID,RACE_ID,SLOT,LAP_NR,CYCLE,COUNT,VOLTS,AMPERES) "
+                                       "VALUES(?,?,?,?,?,?,?,?);")))
+            return fail;
+
+         db->bindInt64(stmt, 1, lapId);
+         db->bindInt(stmt,   2, raceId);
+         db->bindInt(stmt,   3, job->slot);
+         db->bindInt(stmt,   4, job->lap);
+         db->bindInt(stmt,   5, job->cycle);
+         db->bindInt(stmt,   6, job->volts.size());
+         db->bindBlob(stmt,  7, volts.constData(), volts.size());
+         db->bindBlob(stmt,  8, amperes.constData(), amperes.size());
+
+         if (db->step(stmt) != success)
+            tell(eloAlways, "Error: Storing telemetry failed, %s", db->lastError());
+         else
+            tell(eloDebug, "Telemetry of lap %d (slot %d), %d samples in %d/%d byte",
+                 job->lap, job->slot, job->volts.size(), volts.size(), amperes.size());
+
+         break;
+      }
+
+      case RaceJob::rjFinished:
+      {
+         if (raceId == na)
+            return ignore;
+
+         if ((stmt = db->getStatement("UPDATE races SET STATE = ? WHERE RACE_ID = ?;")))
+         {
+            db->bindInt(stmt, 1, rsFinished);
+            db->bindInt(stmt, 2, raceId);
+            db->step(stmt);
+         }
+
+         updateRaceRecord(0);
+         updateRaceRecord(1);
+
+         tell(eloDetail, "Race (%d) finished", raceId);
+         raceId = na;
+         lapIds[0].clear();
+         lapIds[1].clear();
+
+         break;
+      }
+
+      case RaceJob::rjAborted:
+      {
+         if (raceId == na)
+            return ignore;
+
+         if (store)
+            store->drop(raceId);
+
+         if ((stmt = db->getStatement("DELETE FROM lap_telemetry WHERE RACE_ID = ?;")))
+         {
+            db->bindInt(stmt, 1, raceId);
+            db->step(stmt);
+            db->reset(stmt);
+         }
+
+         if ((stmt = db->getStatement("DELETE FROM laps WHERE RACE_ID = ?;")))
+         {
+            db->bindInt(stmt, 1, raceId);
+            db->step(stmt);
+            db->reset(stmt);
+         }
+
+         if ((stmt = db->getStatement("DELETE FROM races WHERE RACE_ID = ?;")))
+         {
+            db->bindInt(stmt, 1, raceId);
+            db->step(stmt);
+            db->reset(stmt);
+            stmt = 0;
+         }
+
+         // the laps of the race are gone, build their records again
+
+         buildRecords(&keys[0]);
+         buildRecords(&keys[1]);
+
+         tell(eloDetail, "Race (%d) aborted, removed", raceId);
+         raceId = na;
+         lapIds[0].clear();
+         lapIds[1].clear();
+
+         break;
+      }
+
+      case RaceJob::rjRecover:
+      {
+         // races still running are left by a crash or power loss, keep the
+         // laps written so far and close them as recovered
+
+         Array<int> ids;
+
+         {
+            SqliteDb::Cursor cursor(db, "SELECT RACE_ID FROM races WHERE STATE = ?;");
+
+            db->bindInt(cursor.getStatement(), 1, rsRunning);
+
+            while (cursor.next())
+               ids.append(cursor.getInt(0));
+         }
+
+         for (int i = 0; i < ids.getCount(); i++)
+         {
+            int laps = 0;
+
+            {
+               SqliteDb::Cursor cursor(db, "SELECT max(LAP_NR) FROM laps WHERE RACE_ID = ?;");
+
+               db->bindInt(cursor.getStatement(), 1, ids[i]);
+
+               if (cursor.next())
+                  laps = cursor.getInt(0);
+            }
+
+            if (!laps)
+               stmt = db->getStatement("DELETE FROM races WHERE RACE_ID = ?;");
+            else
+               stmt = db->getStatement("UPDATE races SET STATE = ?, LAPS = ? WHERE RACE_ID = ?;");
+
+            if (!stmt)
+               continue;
+
+            if (laps)
+            {
+               db->bindInt(stmt, 1, rsRecovered);
+               db->bindInt(stmt, 2, laps);
+               db->bindInt(stmt, 3, ids[i]);
+            }
+            else
+               db->bindInt(stmt, 1, ids[i]);
+
+            db->step(stmt);
+            db->reset(stmt);
+            stmt = 0;
+
+            tell(eloAlways, "Recovered unfinished race (%d) with (%d) laps", ids[i], laps);
+         }
+
+         // records not built yet (new table)
+
+         {
+            SqliteDb::Cursor cursor(db, "SELECT NOT EXISTS(SELECT 1 FROM records) "
+                                    "AND EXISTS(SELECT 1 FROM laps);");
+
+            if (cursor.next() && cursor.getInt(0))
+            {
+               cursor.reset();
+               buildRecords();
+            }
+         }
+
+         break;
+      }
+
+      case RaceJob::rjRebuild:
+      {
+         return buildRecords();
+      }
+   }
+
+   if (stmt)
+      db->reset(stmt);
+
+   return success;
+}
+
+//***************************************************************************
+// Driver Id Of
+//***************************************************************************
+
+int DbService::driverIdOf(const QString& name)
+{
+   SqliteDb::Statement* stmt;
+   int id;
+
+   {
+      SqliteDb::Cursor cursor(db, "SELECT DRIVER_ID from drivers where NAME=?;");
+
+      db->bindText(cursor.getStatement(), 1, name.toAscii().constData());
+
+      if (cursor.next())
+         return cursor.getInt(0);
+   }
+
+   if (!(stmt = db->getStatement("INSERT INTO drivers(NAME) values(?);")))
+      return na;
+
+   db->bindText(stmt, 1, name.toAscii().constData());
+   db->step(stmt);
+   id = db->getInsertRowId();
+   db->reset(stmt);
+
+   return id;
+}
+
+//***************************************************************************
+// Records
+//***************************************************************************
+
+int DbService::bindKey(SqliteDb::Statement* stmt, const RecordKey* key)
+{
+   db->bindInt(stmt,    1, key->driverId);
+   db->bindText(stmt,   2, key->car.toAscii().constData());
+   db->bindText(stmt,   3, key->course.toAscii().constData());
+   db->bindDouble(stmt, 4, key->lapLength);
+
+   return success;
+}
+
+//***************************************************************************
+// Update Record
+//  - add a lap to the record of its slot
+//***************************************************************************
+
+int DbService::updateRecord(int slot, long long lapId, long long usec, int firstLap)
+{
+   SqliteDb::Statement* stmt;
+
+   if (!(stmt = db->getStatement("INSERT OR IGNORE INTO records"
+                                 "(DRIVER_ID, CAR, COURSE, LAP_LENGTH, LAPS, RACES) "
+                                 "VALUES(?, ?, ?, ?, 0, 0);")))
+      return fail;
+
+   bindKey(stmt, &keys[slot]);
+   db->step(stmt);
+   db->reset(stmt);
+
+   // the expressions see the values before the update
+
+   if (!(stmt = db->getStatement("UPDATE records SET "
+                                 "LAPS = LAPS + 1, "
+                                 "RACES = RACES + ?5, "
+                                 "BEST_LAP_ID = CASE WHEN BEST_LAP IS NULL OR ?6 < BEST_LAP THEN ?7 ELSE BEST_LAP_ID END, "
+                                 "BEST_LAP = CASE WHEN BEST_LAP IS NULL OR ?6 < BEST_LAP THEN ?6 ELSE BEST_LAP END "
+                                 "WHERE DRIVER_ID = ?1 AND CAR = ?2 AND COURSE = ?3 AND LAP_LENGTH = ?4;")))
+      return fail;
+
+   bindKey(stmt, &keys[slot]);
+   db->bindInt(stmt,   5, firstLap ? 1 : 0);
+   db->bindInt64(stmt, 6, usec);
+   db->bindInt64(stmt, 7, lapId);
+
+   if (db->step(stmt) != success)
+      tell(eloAlways, "Error: Updating record failed, %s", db->lastError());
+
+   db->reset(stmt);
+
+   return success;
+}
+
+//***************************************************************************
+// Update Race Record
+//  - the best race is the best average lap of a finished race
+//***************************************************************************
+
+int DbService::updateRaceRecord(int slot)
+{
+   SqliteDb::Statement* stmt;
+   long long average = 0;
+
+   {
+      SqliteDb::Cursor cursor(db, "SELECT CAST(avg(LAP_TIME) AS INTEGER) FROM laps "
+                              "WHERE RACE_ID = ? AND DRIVER_NR = ? AND LAP_TIME IS NOT NULL;");
+
+      db->bindInt(cursor.getStatement(), 1, raceId);
+      db->bindInt(cursor.getStatement(), 2, driverIds[slot]);
+
+      if (cursor.next() && !cursor.isNull(0))
+         average = cursor.getInt64(0);
+   }
+
+   if (!average)
+      return done;
+
+   if (!(stmt = db->getStatement("UPDATE records SET "
+                                 "BEST_RACE_ID = CASE WHEN BEST_RACE IS NULL OR ?5 < BEST_RACE THEN ?6 ELSE BEST_RACE_ID END, "
+                                 "BEST_RACE = CASE WHEN BEST_RACE IS NULL OR ?5 < BEST_RACE THEN ?5 ELSE BEST_RACE END "
+                                 "WHERE DRIVER_ID = ?1 AND CAR = ?2 AND COURSE = ?3 AND LAP_LENGTH = ?4;")))
+      return fail;
+
+   bindKey(stmt, &keys[slot]);
+   db->bindInt64(stmt, 5, average);
+   db->bindInt(stmt,   6, raceId);
+   db->step(stmt);
+   db->reset(stmt);
+
+   return success;
+}
+
+//***************************************************************************
+// Build Records
+//  - build the records of 'key' from the laps, all records if 'key' is 0
+//***************************************************************************
+
+int DbService::buildRecords(const RecordKey* key)
+{
+   struct Step
+   {
+      const char* sql;
+      const char* filter;           // '%s' of 'sql' if build for a key
+      int state;                    // race state bound as ?5, na for none
+   };
+
+   static const char* where = " WHERE DRIVER_ID = ?1 AND CAR = ?2 AND COURSE = ?3 AND LAP_LENGTH = ?4";
+
+   static Step steps[] =
+   {
+      { "DELETE FROM records%s;", where, na },
+
+      { "INSERT INTO records(DRIVER_ID, CAR, COURSE, LAP_LENGTH, BEST_LAP, BEST_LAP_ID, LAPS, RACES) "
+        "SELECT DRIVER_ID, CAR, COURSE, LAP_LENGTH, min(LAP_TIME), LAP_ID, count(*), count(DISTINCT RACE_ID) "
+        "FROM record_laps%s GROUP BY DRIVER_ID, CAR, COURSE, LAP_LENGTH;", where, na },
+
+      // average lap per finished race and driver
+
+      { "DROP TABLE IF EXISTS temp.race_results;%s", "", na },
+
+      { "CREATE TEMP TABLE race_results AS "
+        "SELECT RACE_ID, DRIVER_ID, CAR, COURSE, LAP_LENGTH, CAST(avg(LAP_TIME) AS INTEGER) AS AVG_LAP "
+        "FROM record_laps WHERE STATE = ?5%s GROUP BY RACE_ID, DRIVER_ID;",
+        " AND DRIVER_ID = ?1 AND CAR = ?2 AND COURSE = ?3 AND LAP_LENGTH = ?4", rsFinished },
+
+      { "UPDATE records SET "
+        "BEST_RACE = (SELECT min(AVG_LAP) FROM race_results AS x WHERE x.DRIVER_ID = records.DRIVER_ID "
+        "AND x.CAR = records.CAR AND x.COURSE = records.COURSE AND x.LAP_LENGTH = records.LAP_LENGTH), "
+        "BEST_RACE_ID = (SELECT RACE_ID FROM race_results AS x WHERE x.DRIVER_ID = records.DRIVER_ID "
+        "AND x.CAR = records.CAR AND x.COURSE = records.COURSE AND x.LAP_LENGTH = records.LAP_LENGTH "
+        "ORDER BY AVG_LAP LIMIT 1)%s;", where, na },
+
+      { "DROP TABLE race_results;%s", "", na },
+
+      { 0, 0, na }
+   };
+
+   SqliteDb::Statement* stmt;
+   char sql[1000];
+   timeval start, now;
+   int status = success;
+
+   SlotService::tvNow(&start);
+
+   for (int i = 0; steps[i].sql; i++)
+   {
+      sprintf(sql, steps[i].sql, key ? steps[i].filter : "");
+
+      if (!(stmt = db->getStatement(sql)))
+         return fail;
+
+      if (key && *steps[i].filter)
+         bindKey(stmt, key);
+
+      if (steps[i].state != na)
+         db->bindInt(stmt, 5, steps[i].state);
+
+      if (db->step(stmt) != success)
+      {
+         tell(eloAlways, "Error: Building records failed, %s", db->lastError());
+         status = fail;
+      }
+
+      db->reset(stmt);
+   }
+
+   SlotService::tvNow(&now);
+
+   if (!key)
+      tell(eloAlways, "Records rebuilt in (%lld) ms", SlotService::elapsed(&start, &now) / 1000);
+
+   return status;
+}
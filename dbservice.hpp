@@ -0,0 +1,234 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File dbservice.hpp
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+#ifndef _DBSERVICE_H_
+#define _DBSERVICE_H_
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <sys/time.h>
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QPointer>
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#include <sqlite.hpp>
+#include <tsstore.hpp>
+
+//***************************************************************************
+// Class DbJob
+//  - a unit of work executed by the db service thread,
+//    execute() runs in the service thread inside the transaction of its batch
+//***************************************************************************
+
+class DbJob
+{
+   friend class DbService;
+
+   public:
+
+      DbJob();
+      virtual ~DbJob();
+
+      virtual int execute(SqliteDb* db) = 0;
+
+      int getStatus()             { return status; }
+      long long getLatency()      { return latency; }   // [us] queued until committed
+
+   protected:
+
+      int status;
+      int urgent;                 // someone waits for the result
+      int owned;                  // submitted, deleted by the service
+      int ownTransaction;         // executed outside of the batch transaction
+      int done;
+      timeval queued;
+      long long latency;
+
+      QPointer<QObject> receiver;
+      const char* member;
+};
+
+//***************************************************************************
+// Class DbQuery
+//  - one statement with its parameters, the rows are copied as QVariant
+//    so they can be used by the GUI after the job is done
+//***************************************************************************
+
+class DbQuery : public DbJob
+{
+   public:
+
+      DbQuery(const char* aSql);
+
+      DbQuery& bind(const QVariant& value)   { params.append(value); return *this; }
+      int execute(SqliteDb* db);
+
+      int getRowCount()                      { return rows.size(); }
+      int getColumnCount()                   { return names.size(); }
+      const QString& getName(int col)        { return names.at(col); }
+      const QVariant& value(int row, int col) { return rows.at(row).at(col); }
+      long long getInsertRowId()             { return insertRowId; }
+
+   protected:
+
+      QByteArray sql;
+      QList<QVariant> params;
+      QStringList names;
+      QList<QList<QVariant> > rows;
+      long long insertRowId;
+};
+
+//***************************************************************************
+// Class DbService
+//  - owns the only connection to the database (WAL mode), all reads
+//    and writes are queued as jobs and executed by this thread
+//  - jobs are batched in one transaction, writes are grouped up to
+//    'commitInterval', a job someone waits for is executed at once
+//  - submit() is fire and forget, the result is delivered to the slot
+//    'member(DbJob*)' of 'receiver' in the GUI thread, the job is deleted after
+//    (by close() if the GUI didn't take the result anymore)
+//  - call() blocks the caller until the job is committed, use it only
+//    where the answer is needed at once
+//  - the race and its laps are written while the race is running, races
+//    left 'running' by a crash are recovered with the laps written so far
+//  - the records (best lap, best race and counts per driver, car, course
+//    and lap length) are updated with every lap, rebuildRecords()
+//    regenerates them from the laps
+//  - the telemetry of a lap is written to the time series store if one is
+//    opened, else coded to the table lap_telemetry with the lap's id
+//***************************************************************************
+
+class DbService : public QThread
+{
+      Q_OBJECT
+
+   public:
+
+      enum RaceState
+      {
+         rsRunning,
+         rsFinished,
+         rsRecovered
+      };
+
+      enum Misc
+      {
+         commitInterval = 500,        // [ms] group the writes of this time
+         slowBatch = 100              // [ms] report batches slower than this
+      };
+
+      // object
+
+      DbService(const char* aPath);
+      virtual ~DbService();
+
+      // interface
+
+      int open();
+      void close();
+      int isOpen()                  { return db != 0; }
+      int openStore(const char* storePath);
+      const char* getStorePath()    { return store ? store->getPath() : 0; }
+      TsReader* getStoreReader()    { return storeReader; }   // for the jobs only
+
+      void submit(DbJob* job, QObject* receiver = 0, const char* member = 0);
+      int call(DbJob* job);
+
+      int recover();
+      int rebuildRecords();
+
+      // race
+
+      void raceStarted(const char* driver1, const char* driver2,
+                       const char* car1, const char* car2,
+                       int laps, double lapLength, const char* course);
+      void lapDone(int slot, int lap, long long usec);
+      void telemetryDone(int slot, int lap, long long start, int cycle,
+                         const QByteArray& volts, const QByteArray& amperes);
+      void raceFinished();
+      void raceAborted();
+
+      // statistic
+
+      int getQueueDepth();
+      int getMaxQueueDepth()        { return maxQueueDepth; }
+      long long getLatency()        { return jobCount ? latencySum / jobCount : 0; }
+      long long getMaxLatency()     { return maxLatency; }
+
+   signals:
+
+      void resultsReady();
+
+   private slots:
+
+      void onResultsReady();
+
+   protected:
+
+      class RaceJob;
+      friend class RaceJob;
+
+      struct RecordKey
+      {
+         int driverId;
+         QString car;
+         QString course;
+         double lapLength;
+      };
+
+      void run();
+      void enqueue(DbJob* job);
+      int executeRace(RaceJob* job);
+      int driverIdOf(const QString& name);
+      int bindKey(SqliteDb::Statement* stmt, const RecordKey* key);
+      int updateRecord(int slot, long long lapId, long long usec, int firstLap);
+      int updateRaceRecord(int slot);
+      int buildRecords(const RecordKey* key = 0);
+
+      // data
+
+      char* path;
+      SqliteDb* db;
+      TsWriter* store;
+      TsReader* storeReader;         // kept open, used by the jobs in this thread
+      int running;
+
+      QMutex mutex;
+      QWaitCondition jobsPending;
+      QWaitCondition jobsDone;
+      QList<DbJob*> jobs;
+      QList<DbJob*> results;         // submitted jobs done, not delivered yet
+      int urgentJobs;
+
+      // statistic
+
+      int maxQueueDepth;
+      long jobCount;
+      long long latencySum;
+      long long maxLatency;
+
+      // used by the thread only
+
+      int raceId;
+      int driverIds[2];
+      RecordKey keys[2];             // records of the running race
+      QHash<int,long long> lapIds[2];  // LAP_ID by lap number, until its telemetry is stored
+};
+
+//***************************************************************************
+#endif // _DBSERVICE_H_
@@ -0,0 +1,247 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File gcprofile.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <gcprofile.hpp>
+
+//***************************************************************************
+// Object
+//***************************************************************************
+
+GcProfile::GcProfile()
+{
+   scale = gcScale100;
+}
+
+//***************************************************************************
+// Load
+//***************************************************************************
+
+int GcProfile::load(SqliteDb* db, int profileId)
+{
+   Value value;
+
+   values.clear();
+   scale = gcScale100;
+
+   // profiles without SCALE are recorded with the old 100ms intervall
+
+   {
+      SqliteDb::Cursor cursor(db, "select ifnull(SCALE, 100) from profiles where PROFILE_ID = ?;");
+
+      db->bindInt(cursor.getStatement(), 1, profileId);
+
+      if (cursor.next())
+         setScale(cursor.getInt(0));
+   }
+
+   SqliteDb::Cursor cursor(db, "select VOLT, AMPERE from lap_profiles where PROFILE_ID = ? order by LAP_PROFILE_ID;");
+
+   db->bindInt(cursor.getStatement(), 1, profileId);
+
+   while (cursor.next())
+   {
+      value.volt = (byte)cursor.getInt(0);
+      value.ampere = (byte)cursor.getInt(1);
+      values.append(value);
+   }
+
+   return values.size() ? success : fail;
+}
+
+//***************************************************************************
+// Class GcProfileQuery
+//***************************************************************************
+
+GcProfileQuery::GcProfileQuery(const QString& aName)
+   : DbJob()
+{
+   name = aName;
+   profileId = na;
+}
+
+int GcProfileQuery::execute(SqliteDb* db)
+{
+   {
+      SqliteDb::Cursor cursor(db, "select PROFILE_ID from profiles where NAME = ?;");
+
+      db->bindText(cursor.getStatement(), 1, name.toAscii().constData());
+
+      if (cursor.next())
+         profileId = cursor.getInt(0);
+   }
+
+   if (profileId == na)
+      return fail;
+
+   return profile.load(db, profileId);
+}
+
+//***************************************************************************
+// Value At
+//  - linear interpolation between the recorded values,
+//    returns fail if 'msec' is behind the end of the profile
+//***************************************************************************
+
+int GcProfile::valueAt(double msec, Value& value)
+{
+   if (values.isEmpty() || msec < 0)
+      return fail;
+
+   double pos = msec / scale;
+   int i = (int)pos;
+
+   if (i >= values.size()-1)
+   {
+      value = values.last();
+      return i >= values.size() ? fail : success;
+   }
+
+   double f = pos - i;
+   const Value& a = values.at(i);
+   const Value& b = values.at(i+1);
+
+   value.volt = (byte)(a.volt + (b.volt - a.volt) * f + 0.5);
+   value.ampere = (byte)(a.ampere + (b.ampere - a.ampere) * f + 0.5);
+
+   return success;
+}
+
+//***************************************************************************
+// Class GcAlignment
+//***************************************************************************
+//***************************************************************************
+// Object
+//***************************************************************************
+
+GcAlignment::GcAlignment()
+{
+   reset();
+}
+
+void GcAlignment::reset()
+{
+   rate = 1.0;
+   lapCount = 0;
+
+   for (int i = 0; i < lapHistory; i++)
+      targets[i] = 1.0;
+}
+
+//***************************************************************************
+// Sync
+//  - called at each lap signal of the ghost car
+//
+//    duration  length of the profile [ms]
+//    lapMsec   measured duration of the lap [ms]
+//    position  replay position reached at the lap signal [ms], greater than
+//              'duration' if the last value was frozen
+//***************************************************************************
+
+int GcAlignment::sync(double duration, double lapMsec, double position)
+{
+   const double gain = 0.5;             // damp correction to avoid oscillation
+   const double minRate = 0.75;
+   const double maxRate = 1.25;
+
+   double target = 0;
+
+   // ignore the run up to the first lap signal as well as
+   // laps with crashes, penalties or fueling stops
+
+   if (duration <= 0 || position <= 0
+       || lapMsec < duration * 0.5 || lapMsec > duration * 2.0)
+   {
+      tell(eloDetail, "GC sync: ignoring lap of %.0fms for profile of %.0fms",
+           lapMsec, duration);
+      return ignore;
+   }
+
+   // the rate this lap had needed to reach the end of the profile
+   // exactly at the lap signal
+
+   targets[lapCount++ % lapHistory] = rate * duration / position;
+
+   for (int i = 0; i < qMin(lapCount, (int)lapHistory); i++)
+      target += targets[i];
+
+   target /= qMin(lapCount, (int)lapHistory);
+
+   rate += gain * (target - rate);
+   rate = qMax(minRate, qMin(maxRate, rate));
+
+   tell(eloDetail, "GC sync: lap %.0fms, sync error %+.1f%%, replay rate now %.3f",
+        lapMsec, (position - duration) / duration * 100.0, rate);
+
+   return done;
+}
+
+//***************************************************************************
+// Decode Block
+//  - append the samples of a delta/RLE coded block (see GhostCarCoding),
+//    returns the number of decoded samples
+//***************************************************************************
+
+int GcProfile::decodeBlock(const GhostCarBlock* block, QList<Value>& values)
+{
+   Value v;
+   int count = 0;
+   int p = 0;
+
+   if (!block->count)
+      return 0;
+
+   v.volt = block->volt;
+   v.ampere = block->ampere;
+   values.append(v);
+   count++;
+
+   while (count < block->count && p < sizeGcBlockData)
+   {
+      byte token = block->data[p++];
+
+      if (token == gccAbsolute)
+      {
+         if (p + 2 > sizeGcBlockData)
+            break;
+
+         v.volt = block->data[p++];
+         v.ampere = block->data[p++];
+         values.append(v);
+         count++;
+      }
+      else if ((token & gccRunMask) == gccRun)
+      {
+         for (int n = (token & gccRunMax) + 1; n > 0 && count < block->count; n--)
+         {
+            values.append(v);
+            count++;
+         }
+      }
+      else if (!(token & gccDeltaMask))
+      {
+         v.volt += ((token >> 3) & 0x0F) - 8;
+         v.ampere += (token & 0x07) - 4;
+         values.append(v);
+         count++;
+      }
+      else
+      {
+         break;        // unknown token
+      }
+   }
+
+   if (count != block->count)
+      tell(eloAlways, "Warning: Ghost car block corrupt, got (%d) of (%d) samples",
+           count, block->count);
+
+   return count;
+}
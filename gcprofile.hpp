@@ -0,0 +1,125 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File gcprofile.hpp
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+#ifndef _GC_PROFILE_H_
+#define _GC_PROFILE_H_
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <QList>
+
+#include <common.hpp>
+#include <ioservice.hpp>
+#include <dbservice.hpp>
+
+//***************************************************************************
+// Class GcProfile
+//  - the recorded volt/ampere values of one ghost car lap
+//***************************************************************************
+
+class GcProfile : public IoService
+{
+   public:
+
+      struct Value
+      {
+         byte volt;
+         byte ampere;
+      };
+
+      // object
+
+      GcProfile();
+
+      // interface
+
+      int load(SqliteDb* db, int profileId);
+      void clear()                   { values.clear(); }
+      void append(Value v)           { values.append(v); }
+      int valueAt(double msec, Value& value);
+
+      // get / set
+
+      int isEmpty()                  { return values.isEmpty(); }
+      int getCount()                 { return values.size(); }
+      const Value& at(int i)         { return values.at(i); }
+      int getScale()                 { return scale; }
+      void setScale(int s)           { scale = s > 0 ? s : gcScale100; }
+      double getDuration()           { return values.size() * (double)scale; }
+
+      // block decoding
+
+      static int decodeBlock(const GhostCarBlock* block, QList<Value>& values);
+
+   protected:
+
+      // data
+
+      QList<Value> values;
+      int scale;                     // ms per value
+};
+
+//***************************************************************************
+// Class GcProfileQuery
+//  - loads the profile of a ghost car driver, executed by the db service
+//***************************************************************************
+
+class GcProfileQuery : public DbJob
+{
+   public:
+
+      GcProfileQuery(const QString& aName);
+
+      int execute(SqliteDb* db);
+
+      QString name;
+      int profileId;
+      GcProfile profile;
+};
+
+//***************************************************************************
+// Class GcAlignment
+//  - warps the replay of a profile to the measured lap duration,
+//    the replay rate is corrected by the sync error of the recent laps
+//***************************************************************************
+
+class GcAlignment
+{
+   public:
+
+      enum Misc
+      {
+         lapHistory = 3            // laps used to smooth the correction
+      };
+
+      // object
+
+      GcAlignment();
+
+      // interface
+
+      void reset();
+      int sync(double duration, double lapMsec, double position);
+
+      // get
+
+      double getRate()               { return rate; }
+
+   protected:
+
+      // data
+
+      double rate;                   // profile ms per real ms
+      double targets[lapHistory];    // rates needed by the recent laps
+      int lapCount;
+};
+
+//***************************************************************************
+#endif // _GC_PROFILE_H_
@@ -21,7 +21,7 @@
 
 HighscoreDialog::HighscoreDialog()
 { 
-   db = 0;
+   dbService = 0;
 
    setupUi(this);
 
@@ -29,8 +29,13 @@ HighscoreDialog::HighscoreDialog()
    tableWidgetRaces->setEditTriggers(QAbstractItemView::NoEditTriggers);
    tableWidgetLaps->setSelectionBehavior(QAbstractItemView::SelectRows);
    tableWidgetLaps->setEditTriggers(QAbstractItemView::NoEditTriggers);
-   tableWidgetBestOf->setSelectionBehavior(QAbstractItemView::SelectRows);
-   tableWidgetBestOf->setEditTriggers(QAbstractItemView::NoEditTriggers);
+   tableWidgetStatistics->setSelectionBehavior(QAbstractItemView::SelectRows);
+   tableWidgetStatistics->setEditTriggers(QAbstractItemView::NoEditTriggers);
+
+   bestOf = new BestOfModel(this);
+   tableViewBestOf->setModel(bestOf);
+   tableViewBestOf->setSelectionBehavior(QAbstractItemView::SelectRows);
+   tableViewBestOf->setEditTriggers(QAbstractItemView::NoEditTriggers);
 }
 
 HighscoreDialog::~HighscoreDialog()
@@ -52,163 +57,372 @@ void HighscoreDialog::on_tableWidgetRaces_currentCellChanged(int currentRow, int
 
 //***************************************************************************
 // Fill Widgets
+//  - the queries are executed by the db service, the widgets are
+//    filled when the results are delivered
 //***************************************************************************
 
 int HighscoreDialog::fill()
 {
    fillRaces();
-   fillBestOf();
+   fillStatistics();
+   bestOf->reload();
 
    return 0;
 }
 
-int HighscoreDialog::fillBestOf()
-{
-   db->execute("SELECT "                                                \
-               "r.RACE_ID, "                                            \
-               "d.NAME AS Fahrer, "                                     \
-               "l.LAP_TIME AS Zeit, "                                   \
-               "r.DATE AS Datum, "                                      \
-               "r.LAP_LENGTH AS Lnge, "                                \
-               "r.COURSE AS Strecke "                                   \
-               "from races AS r, "                                      \
-               "laps AS l, "                                            \
-               "drivers AS d "                                          \
-               "WHERE l.RACE_ID=r.RACE_ID and "                         \
-               "d.DRIVER_ID=l.DRIVER_NR and "                           \
-               "l.LAP_TIME IS NOT NULL "                                \
-               "ORDER BY l.LAP_TIME;");
-   
-   fillTableWidget(tableWidgetBestOf, db, 1);
+int HighscoreDialog::fillRaces()
+{
+   if (!dbService)
+      return fail;
+
+   dbService->submit(new DbQuery("SELECT "                 \
+                                 "RACE_ID, "               \
+                                 "DATE AS Datum, "         \
+                                 "LAPS AS Runden, "        \
+                                 "LAP_LENGTH AS Lnge, "   \
+                                 "COURSE AS Strecke "      \
+                                 "from races ORDER BY DATE DESC;"),
+                     this, "onRacesLoaded");
 
    return 0;
 }
 
-int HighscoreDialog::fillRaces()
+int HighscoreDialog::fillLaps(int raceId)
 {
-   db->execute("SELECT "                 \
-               "RACE_ID, "               \
-               "DATE AS Datum, "         \
-               "LAPS AS Runden, "        \
-               "LAP_LENGTH AS Lnge, "   \
-               "COURSE AS Strecke "      \
-               "from races ORDER BY DATE DESC;");
-   
-   fillTableWidget(tableWidgetRaces, db, 1);
+   DbQuery* laps;
+
+   if (!dbService)
+      return fail;
+
+   // the laps of the race by idx_laps_race, ordered by lane (NULL for
+   //  old races with the same driver in both lanes), driver and lap
+
+   laps = new DbQuery("SELECT l.SLOT, l.DRIVER_NR, d.NAME, l.LAP_NR, l.LAP_TIME "
+                      "FROM laps AS l "
+                      "LEFT JOIN drivers AS d ON d.DRIVER_ID = l.DRIVER_NR "
+                      "WHERE l.RACE_ID = ? "
+                      "ORDER BY l.SLOT, l.DRIVER_NR, l.LAP_NR;");
+
+   laps->bind(raceId);
+   dbService->submit(laps, this, "onLapsLoaded");
 
    return 0;
 }
 
-int HighscoreDialog::fillLaps(int raceId)
+int HighscoreDialog::fillStatistics()
 {
-   sqlite3_stmt* sqlSelectLaps;
-   char sql[1000];
-   char driver1[100];
-   char driver2[100];
-
-   // get driver names
-
-   sprintf(sql, "SELECT d.NAME from drivers AS d, races AS r where d.DRIVER_ID=r.DRIVER1 and r.RACE_ID=%d;", raceId);
-   db->execute(sql);
-   // free(sql);
-   strcpy(driver1, db->getValueOf("NAME"));
-
-   sprintf(sql, "SELECT d.NAME from drivers AS d, races AS r where d.DRIVER_ID=r.DRIVER2 and r.RACE_ID=%d;", raceId);
-   db->execute(sql);
-   // free(sql);
-   strcpy(driver2, db->getValueOf("NAME"));
-   
-   // build statement
-
-   sprintf(sql, "SELECT "                                             \
-           "a.lap_nr AS Runde, "                                        \
-           "a.lap_time AS '%s', "                                       \
-           "b.lap_time AS '%s' "                                        \
-           "from laps AS a INNER JOIN laps AS b ON "                    \
-           "a.race_id=b.race_id and "                                   \
-           "a.lap_nr=b.lap_nr and "                                     \
-           "b.race_id=? and "                                           \
-           "a.driver_nr=1 and "                                         \
-           "b.driver_nr=2 ORDER BY a.LAP_NR;",
-           driver1, driver2);
-   
-   // execute statement
-
-   db->prepare(sql, sqlSelectLaps);
-   db->bindInt(sqlSelectLaps, 1, raceId);
-   db->steps(sqlSelectLaps);
-   db->reset(sqlSelectLaps);
-   db->finalize(sqlSelectLaps);
-   // free(sql);
-
-   // and fill table widget
-
-   fillTableWidget(tableWidgetLaps, db);
+   if (!dbService)
+      return fail;
+
+   // the job returns at once if no lap was added since the last time
+
+   dbService->submit(statistics.createJob(), this, "onStatisticsLoaded");
 
    return 0;
 }
 
-int HighscoreDialog::fillTableWidget(QTableWidget* widget, SqliteDb* db, int startCol)
+//***************************************************************************
+// On Results
+//***************************************************************************
+
+void HighscoreDialog::onRacesLoaded(DbJob* job)
 {
-   SqliteDb::Result* r;
-   SqliteDb::Field* f;
+   fillTableWidget(tableWidgetRaces, (DbQuery*)job, 1);
+}
+
+void HighscoreDialog::onLapsLoaded(DbJob* job)
+{
+   DbQuery* laps = (DbQuery*)job;
    QStringList header;
+   QVariant lastSlot;
+   int lastDriver = na;
+   int col = 0;
+   int rows = 0;
 
-   int col;
-   int row = 0;
-   int id = 0;
+   tableWidgetLaps->clear();
+   tableWidgetLaps->setRowCount(0);
 
-   if (!db)
-      return -1;
+   if (laps->getStatus() != success)
+      return ;
 
-   widget->clear();
-   widget->setRowCount(db->getResultCount());
+   // pivot, a column for each lane and driver of the race, a row for each lap
 
-   if (!db->getResultCount())
-      return 0;
+   for (int i = 0; i < laps->getRowCount(); i++)
+      rows = qMax(rows, laps->value(i, 3).toInt());
 
-   // header
+   header << "Runde";
+   tableWidgetLaps->setRowCount(rows);
 
-   if ((r = db->getFirstResult()))
+   for (int i = 0; i < laps->getRowCount(); i++)
    {
-      if (!(r->getFieldCount()-startCol))
-         return 0;
-
-      widget->setColumnCount(r->getFieldCount()-startCol);
-      col = 0;
+      QVariant slot = laps->value(i, 0);
+      int driver = laps->value(i, 1).toInt();
+      int lap = laps->value(i, 3).toInt();
 
-      for (f = (SqliteDb::Field*)r->fields.getFirst(); f; f = (SqliteDb::Field*)r->fields.getNext())
+      if (driver != lastDriver || slot != lastSlot)
       {
-         if (col >= startCol)
-            header << f->name;
+         lastDriver = driver;
+         lastSlot = slot;
 
-         col++;
+         if (slot.isNull())
+            header << laps->value(i, 2).toString();
+         else
+            header << laps->value(i, 2).toString() + " (Bahn " + QString::number(slot.toInt() + 1) + ")";
+
+         tableWidgetLaps->setColumnCount(header.size());
+         col = header.size() - 1;
       }
+
+      if (lap < 1 || laps->value(i, 4).isNull())
+         continue;
+
+      double sec = laps->value(i, 4).toLongLong() / 1000000.0;
+
+      tableWidgetLaps->setItem(lap-1, col, new QTableWidgetItem(QString::number(sec, 'f', 3)));
    }
 
+   tableWidgetLaps->setColumnCount(header.size());
+   tableWidgetLaps->setHorizontalHeaderLabels(header);
+
+   for (int lap = 0; lap < rows; lap++)
+      tableWidgetLaps->setItem(lap, 0, new QTableWidgetItem(QString::number(lap+1)));
+}
+
+void HighscoreDialog::onStatisticsLoaded(DbJob* job)
+{
+   static const char* titles[] = { "Fahrer", "Auto", "Strecke", "Lnge", "Runden", "Rennen",
+                                   "Beste", "Mittel", "Median", "P90", "Streuung",
+                                   "Konstanz [%]", "Trend [ms/Rennen]", 0 };
+   QStringList header;
+
+   if (!statistics.update((Statistics::Job*)job) && tableWidgetStatistics->rowCount())
+      return ;
+
+   for (int i = 0; titles[i]; i++)
+      header << titles[i];
+
+   tableWidgetStatistics->clear();
+   tableWidgetStatistics->setColumnCount(header.size());
+   tableWidgetStatistics->setHorizontalHeaderLabels(header);
+   tableWidgetStatistics->setRowCount(statistics.getCount());
+
+   for (int row = 0; row < statistics.getCount(); row++)
+   {
+      const Statistics::Entry& e = statistics.at(row);
+      QStringList values;
+
+      values << e.driver << e.car << e.course
+             << QString::number(e.lapLength)
+             << QString::number(e.laps)
+             << QString::number(e.races)
+             << QString::number(e.best / 1000000.0, 'f', 3)
+             << QString::number(e.mean / 1000000.0, 'f', 3)
+             << QString::number(e.median / 1000000.0, 'f', 3)
+             << QString::number(e.p90 / 1000000.0, 'f', 3)
+             << QString::number(e.deviation / 1000000.0, 'f', 3)
+             << QString::number(e.consistency, 'f', 1)
+             << QString::number(e.trend / 1000.0, 'f', 1);
+
+      for (int col = 0; col < values.size(); col++)
+         tableWidgetStatistics->setItem(row, col, new QTableWidgetItem(values.at(col)));
+   }
+}
+
+//***************************************************************************
+// Fill Table Widget
+//  - the first column is stored as type (id) of the items,
+//    the columns from 'startCol' on are shown
+//***************************************************************************
+
+int HighscoreDialog::fillTableWidget(QTableWidget* widget, DbQuery* query, int startCol)
+{
+   QStringList header;
+   int cols;
+   int id = 0;
+
+   widget->clear();
+   widget->setRowCount(0);
+
+   if (query->getStatus() != success || (cols = query->getColumnCount()) <= startCol)
+      return -1;
+
+   // header
+
+   widget->setColumnCount(cols-startCol);
+
+   for (int col = startCol; col < cols; col++)
+      header << query->getName(col);
+
    widget->setHorizontalHeaderLabels(header);
-   widget->horizontalHeaderItem(1)->font().setBold(true);
-   
+
+   if (widget->columnCount() > 1)
+      widget->horizontalHeaderItem(1)->font().setBold(true);
+
    // values
 
-   for (r = db->getFirstResult(); r; r = db->getNextResult())
+   widget->setRowCount(query->getRowCount());
+
+   for (int row = 0; row < query->getRowCount(); row++)
    {
-      col = 0;
+      id = query->value(row, 0).toInt();
 
-      for (f = (SqliteDb::Field*)r->fields.getFirst(); f; 
-           f = (SqliteDb::Field*)r->fields.getNext())
-      {
-         if (!col)
-            id = atoi(f->value);
+      for (int col = startCol; col < cols; col++)
+         widget->setItem(row, col-startCol, new QTableWidgetItem(query->value(row, col).toString(), id));
+   }
 
-         if (col >= startCol)
-            widget->setItem(row, col-startCol, new QTableWidgetItem(f->value, id));
+   return 0;
+}
 
-         col++;
-      }
+//***************************************************************************
+// Class BestOfModel
+//***************************************************************************
 
-      row++;
+BestOfModel::BestOfModel(QObject* parent)
+   : QAbstractTableModel(parent)
+{
+   dbService = 0;
+   pending = 0;
+   atEnd = yes;
+}
+
+//***************************************************************************
+// Reload
+//  - drop the fetched rows and request the first page,
+//    a page still on the way is ignored when it arrives
+//***************************************************************************
+
+void BestOfModel::reload()
+{
+   if (!rows.isEmpty())
+   {
+      beginRemoveRows(QModelIndex(), 0, rows.size()-1);
+      rows.clear();
+      endRemoveRows();
    }
 
-   return 0;
+   pending = 0;
+   atEnd = !dbService;
+
+   fetchMore(QModelIndex());
+}
+
+//***************************************************************************
+// Fetch More
+//***************************************************************************
+
+bool BestOfModel::canFetchMore(const QModelIndex& parent) const
+{
+   return !parent.isValid() && !atEnd && !pending;
+}
+
+void BestOfModel::fetchMore(const QModelIndex& parent)
+{
+   DbQuery* query;
+
+   if (!canFetchMore(parent))
+      return ;
+
+   // the laps drive the join, so the rows come in index order without sorting
+
+   query = new DbQuery("SELECT l.LAP_ID, l.LAP_TIME, r.RACE_ID, d.NAME, "
+                       "r.DATE, r.LAP_LENGTH, r.COURSE "
+                       "FROM laps AS l "
+                       "CROSS JOIN races AS r ON r.RACE_ID = l.RACE_ID "
+                       "CROSS JOIN drivers AS d ON d.DRIVER_ID = l.DRIVER_NR "
+                       "WHERE l.LAP_TIME >= ? AND (l.LAP_TIME > ? OR l.LAP_ID > ?) "
+                       "ORDER BY l.LAP_TIME, l.LAP_ID LIMIT ?;");
+
+   // continue behind the last fetched row
+
+   qlonglong usec = rows.isEmpty() ? -1 : rows.last().usec;
+   qlonglong lapId = rows.isEmpty() ? 0 : rows.last().lapId;
+
+   query->bind(usec).bind(usec).bind(lapId).bind((int)pageSize);
+
+   pending = query;
+   dbService->submit(query, this, "onPageLoaded");
+}
+
+void BestOfModel::onPageLoaded(DbJob* job)
+{
+   DbQuery* query = (DbQuery*)job;
+
+   if (job != pending)
+      return ;                           // reloaded meanwhile
+
+   pending = 0;
+
+   if (query->getStatus() != success || query->getRowCount() < pageSize)
+      atEnd = yes;
+
+   if (!query->getRowCount())
+      return ;
+
+   beginInsertRows(QModelIndex(), rows.size(), rows.size() + query->getRowCount() - 1);
+
+   for (int i = 0; i < query->getRowCount(); i++)
+   {
+      Row row;
+
+      row.lapId = query->value(i, 0).toLongLong();
+      row.usec = query->value(i, 1).toLongLong();
+      row.raceId = query->value(i, 2).toInt();
+      row.driver = query->value(i, 3).toString();
+      row.date = query->value(i, 4).toString();
+      row.length = query->value(i, 5).toDouble();
+      row.course = query->value(i, 6).toString();
+
+      rows.append(row);
+   }
+
+   endInsertRows();
+}
+
+//***************************************************************************
+// Model Interface
+//***************************************************************************
+
+int BestOfModel::rowCount(const QModelIndex& parent) const
+{
+   return parent.isValid() ? 0 : rows.size();
+}
+
+int BestOfModel::columnCount(const QModelIndex& parent) const
+{
+   return parent.isValid() ? 0 : colCount;
+}
+
+QVariant BestOfModel::data(const QModelIndex& index, int role) const
+{
+   if (!index.isValid() || index.row() >= rows.size())
+      return QVariant();
+
+   const Row& row = rows.at(index.row());
+
+   if (role == Qt::UserRole)
+      return row.raceId;
+
+   if (role != Qt::DisplayRole)
+      return QVariant();
+
+   switch (index.column())
+   {
+      case colDriver: return row.driver;
+      case colTime:   return QString::number(row.usec / 1000000.0, 'f', 3);
+      case colDate:   return row.date;
+      case colLength: return row.length;
+      case colCourse: return row.course;
+   }
+
+   return QVariant();
+}
+
+QVariant BestOfModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+   static const char* titles[colCount] = { "Fahrer", "Zeit", "Datum", "Lnge", "Strecke" };
+
+   if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+      return QAbstractTableModel::headerData(section, orientation, role);
+
+   return section >= 0 && section < colCount ? QString(titles[section]) : QVariant();
 }
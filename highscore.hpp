@@ -14,13 +14,82 @@
 //***************************************************************************
 
 #include <QDialog>
+#include <QAbstractTableModel>
 
 #include <ui_highscore.h>
 
-#include <sqlite.hpp>
+#include <dbservice.hpp>
+#include <statistics.hpp>
 
 //***************************************************************************
-// Class LinslotWindow
+// Class BestOfModel
+//  - the fastest laps, fetched page by page when the view scrolls to the end
+//  - keyset pagination on (LAP_TIME, LAP_ID), served by idx_laps_time,
+//    a page costs the same regardless of the number of laps
+//***************************************************************************
+
+class BestOfModel : public QAbstractTableModel
+{
+      Q_OBJECT
+
+   public:
+
+      enum Column
+      {
+         colDriver,
+         colTime,
+         colDate,
+         colLength,
+         colCourse,
+
+         colCount
+      };
+
+      enum Misc
+      {
+         pageSize = 100
+      };
+
+      BestOfModel(QObject* parent = 0);
+
+      void setDbService(DbService* s)  { dbService = s; }
+      void reload();
+
+      int rowCount(const QModelIndex& parent = QModelIndex()) const;
+      int columnCount(const QModelIndex& parent = QModelIndex()) const;
+      QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+      QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+      bool canFetchMore(const QModelIndex& parent) const;
+      void fetchMore(const QModelIndex& parent);
+
+   private slots:
+
+      void onPageLoaded(DbJob* job);
+
+   protected:
+
+      struct Row
+      {
+         long long lapId;
+         long long usec;
+         int raceId;
+         QString driver;
+         QString date;
+         double length;
+         QString course;
+      };
+
+      // data
+
+      DbService* dbService;
+      QList<Row> rows;
+      DbJob* pending;               // the page on the way, 0 if none
+      int atEnd;
+};
+
+//***************************************************************************
+// Class HighscoreDialog
 //***************************************************************************
 
 class HighscoreDialog : public QDialog, public Ui::HighscoreDialog
@@ -35,21 +104,27 @@ class HighscoreDialog : public QDialog, public Ui::HighscoreDialog
       ~HighscoreDialog();
 
 
-      void setDb(SqliteDb* aDb) { db = aDb; }
+      void setDbService(DbService* s) { dbService = s; bestOf->setDbService(s); }
       int fill();
-      int fillBestOf();
       int fillRaces();
       int fillLaps(int raceId);
-      int fillTableWidget(QTableWidget* widget, SqliteDb* db, int startCol = 0);
+      int fillStatistics();
+      int fillTableWidget(QTableWidget* widget, DbQuery* query, int startCol = 0);
 
    protected:
 
       // data
 
-      SqliteDb* db;
+      DbService* dbService;
+      BestOfModel* bestOf;
+      Statistics statistics;
 
    private slots:
 
+      void onRacesLoaded(DbJob* job);
+      void onLapsLoaded(DbJob* job);
+      void onStatisticsLoaded(DbJob* job);
+
       void on_tableWidgetRaces_currentCellChanged(int currentRow, int currentColumn, 
                                                   int previousRow, int previousColumn);
       
@@ -0,0 +1,182 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File imageservice.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <QMetaType>
+#include <QMutexLocker>
+#include <QPixmapCache>
+
+#include <common.hpp>
+#include <imageservice.hpp>
+
+//***************************************************************************
+// Object
+//***************************************************************************
+
+ImageService::ImageService()
+{
+   running = no;
+
+   qRegisterMetaType<QImage>("QImage");
+
+   connect(this, SIGNAL(imageLoaded(const QString&, const QImage&)),
+           this, SLOT(onImageLoaded(const QString&, const QImage&)),
+           Qt::QueuedConnection);
+}
+
+ImageService::~ImageService()
+{
+   close();
+}
+
+//***************************************************************************
+// Open / Close
+//***************************************************************************
+
+void ImageService::open()
+{
+   if (running)
+      return ;
+
+   running = yes;
+   start(QThread::LowPriority);
+}
+
+void ImageService::close()
+{
+   if (!running)
+      return ;
+
+   // pending images are dropped
+
+   mutex.lock();
+   running = no;
+   requests.clear();
+   requestsPending.wakeAll();
+   mutex.unlock();
+
+   wait();
+   queued.clear();
+}
+
+//***************************************************************************
+// Key Of
+//***************************************************************************
+
+QString ImageService::keyOf(const QString& path, const QSize& size)
+{
+   return path + "@" + QString::number(size.width()) + "x" + QString::number(size.height());
+}
+
+//***************************************************************************
+// Get
+//  - GUI thread, returns success if the pixmap is in the cache,
+//    otherwise the image is queued and 'na' returned
+//***************************************************************************
+
+int ImageService::get(const QString& path, const QSize& size, QPixmap& pixmap)
+{
+   QString key = keyOf(path, size);
+
+   if (QPixmapCache::find(key, &pixmap))
+      return success;
+
+   if (failed.contains(key))
+      return fail;
+
+   if (queued.contains(key) || !running)
+      return na;
+
+   QMutexLocker locker(&mutex);
+
+   // an older size of this image is not needed any more (resizing)
+
+   for (int i = requests.size()-1; i >= 0; i--)
+   {
+      if (requests.at(i).path == path)
+      {
+         queued.remove(keyOf(path, requests.at(i).size));
+         requests.removeAt(i);
+      }
+   }
+
+   Request request;
+
+   request.path = path;
+   request.size = size;
+   requests.append(request);
+   queued.insert(key);
+
+   requestsPending.wakeOne();
+
+   return na;
+}
+
+//***************************************************************************
+// On Image Loaded
+//  - GUI thread, a pixmap can only be created here
+//***************************************************************************
+
+void ImageService::onImageLoaded(const QString& key, const QImage& image)
+{
+   if (!queued.remove(key))
+      return ;                        // outdated
+
+   if (image.isNull())
+   {
+      failed.insert(key);
+      return ;
+   }
+
+   QPixmapCache::insert(key, QPixmap::fromImage(image));
+
+   emit imageReady();
+}
+
+//***************************************************************************
+// Run
+//  - decode and scale the queued images one by one
+//***************************************************************************
+
+void ImageService::run()
+{
+   tell(eloDetail, "ImageService: Thread started");
+
+   while (yes)
+   {
+      Request request;
+
+      mutex.lock();
+
+      while (running && requests.isEmpty())
+         requestsPending.wait(&mutex);
+
+      if (!running)
+      {
+         mutex.unlock();
+         break;
+      }
+
+      request = requests.takeFirst();
+      mutex.unlock();
+
+      QImage image(request.path);
+
+      if (image.isNull())
+         tell(eloAlways, "Warning: Can't load image '%s'", request.path.toAscii().constData());
+      else
+         image = image.scaled(request.size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+      emit imageLoaded(keyOf(request.path, request.size), image);
+   }
+
+   tell(eloDetail, "ImageService: Thread ended");
+}
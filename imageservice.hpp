@@ -0,0 +1,88 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File imageservice.hpp
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+#ifndef _IMAGESERVICE_H_
+#define _IMAGESERVICE_H_
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QSize>
+#include <QImage>
+#include <QPixmap>
+
+//***************************************************************************
+// Class ImageService
+//  - driver and car images, decoded and scaled by this thread (QImage),
+//    the GUI thread only converts the result to a pixmap
+//  - the pixmaps are kept in the QPixmapCache, keyed by path and size
+//  - get() answers from the cache or queues the image, 'imageReady'
+//    is emitted when it's in the cache
+//***************************************************************************
+
+class ImageService : public QThread
+{
+      Q_OBJECT
+
+   public:
+
+      // object
+
+      ImageService();
+      virtual ~ImageService();
+
+      // interface
+
+      void open();
+      void close();
+
+      int get(const QString& path, const QSize& size, QPixmap& pixmap);
+
+   signals:
+
+      void imageReady();
+      void imageLoaded(const QString& key, const QImage& image);
+
+   private slots:
+
+      void onImageLoaded(const QString& key, const QImage& image);
+
+   protected:
+
+      struct Request
+      {
+         QString path;
+         QSize size;
+      };
+
+      static QString keyOf(const QString& path, const QSize& size);
+      void run();
+
+      // data
+
+      int running;
+
+      QMutex mutex;
+      QWaitCondition requestsPending;
+      QList<Request> requests;
+
+      // used by the GUI thread only
+
+      QSet<QString> queued;           // keys requested, not yet in the cache
+      QSet<QString> failed;           // keys which could not be decoded
+};
+
+//***************************************************************************
+#endif // _IMAGESERVICE_H_
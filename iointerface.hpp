@@ -44,6 +44,7 @@ class IoInterface : public IoService
       virtual void stopGhostCar() {}
       virtual void writeGhostCarValue(byte /*volt*/, byte /*ampere*/) {}
       virtual void flushGhostCar() {}
+      virtual void recordTelemetry(int /*cycle*/, const char* /*vBits*/, const char* /*iBits*/) {}
       virtual int initIoSetup(word /*bitsInput*/, word /*bitsOutput*/,
                               byte /*withSpi*/) { return done; }
 
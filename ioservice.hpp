@@ -41,6 +41,7 @@ class IoService
          cGhostCarValue      = 0x09,
          cSetupIo            = 0x0A,
          cGhostCarFlush      = 0x0B,
+         cRecordTelemetry    = 0x0C,
 
          // to PC
 
@@ -48,7 +49,9 @@ class IoService
          cDigitalIn          = 0x0F,
          cAnalogIn           = 0x10,
          cBoardTime          = 0x11,
-         cDebug              = 0x12
+         cDebug              = 0x12,
+         cGhostCarBlock      = 0x13,
+         cTelemetryBlock     = 0x14
       };
 
       enum GhostCarScale
@@ -56,6 +59,8 @@ class IoService
          // interrupt called every 1ms, this is the scale factor for
          // the ghost car recording intervall
 
+         gcScale10  = 10,            // intervall 10ms
+         gcScale20  = 20,            // intervall 20ms
          gcScale100 = 100,           // intervall 100ms
          gcScale200 = 200,           // intervall 200ms
          gcScale300 = 300,           // intervall 300ms
@@ -63,6 +68,33 @@ class IoService
          gcScale500 = 500,           // intervall 500ms
       };
 
+      enum GhostCarCoding
+      {
+         // token layout of GhostCarBlock::data, each token codes the
+         // next sample(s) relative to the previous one
+         //
+         //   0vvvvaaa  volt delta (vvvv - 8) and ampere delta (aaa - 4)
+         //   10nnnnnn  repeat the previous sample n+1 times
+         //   11111111  absolute sample, volt and ampere byte follow
+
+         gccDeltaMask     = 0x80,
+         gccRun           = 0x80,
+         gccRunMask       = 0xC0,
+         gccRunMax        = 0x3F,
+         gccAbsolute      = 0xFF,
+
+         sizeGcBlockData  = 40,      // max bytes of coded data per block
+         gcBlockSamples   = 25       // flush block at least every 25 samples
+      };
+
+      enum Telemetry
+      {
+         // race telemetry, the volt and ampere inputs of each lane are
+         // sampled continuously and sent as ghost car coded blocks
+
+         telemetryLanes   = 2
+      };
+
 #ifndef MKSKETCH
 #  pragma pack(push, 1)
 #endif
@@ -109,6 +141,13 @@ class IoService
          char ampereBit;
       };
 
+      struct RecordTelemetry    // 5 + 2 byte
+      {
+         byte cycle;            // 0 -> off
+         char voltBit[telemetryLanes];
+         char ampereBit[telemetryLanes];
+      };
+
       struct SetupIo            // 5 + 2 byte
       {
          word bitsInput;
@@ -130,6 +169,21 @@ class IoService
          byte ampere;
       };
 
+      struct GhostCarBlock      // 3..43 + 2 byte
+      {
+         byte count;            // samples in block, 0 -> end of recording
+         byte volt;             // first sample, absolute
+         byte ampere;
+         byte data[sizeGcBlockData];
+      };
+
+      struct TelemetryBlock     // 8..48 + 2 byte
+      {
+         byte lane;             // 1..telemetryLanes, a message must not start with 0
+         dword time;            // board time of the first sample [ms]
+         GhostCarBlock block;   // coded samples, sent up to the used data
+      };
+
       struct DebugValue         // 58 + 2 byte
       {
          char string[49+TB];
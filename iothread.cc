@@ -21,13 +21,12 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include <QSqlQuery>
-#include <QVariant>
-
 #include <iothread.hpp>
 #include <common.hpp>
 #include <linslot.hpp>
 #include <arduino.hpp>
+#include <trace.hpp>
+#include <journal.hpp>
 
 //***************************************************************************
 // Class IoThread
@@ -44,6 +43,13 @@ IoThread::IoThread()
    *device = 0;
    command = cNone;
    gcPause = 0;
+   gcPosition = 0;
+   gcFrozen = no;
+   lastInputs = 0;
+   memset(laneInputs, 0, sizeof(laneInputs));
+   memset(laneOutputs, 0, sizeof(laneOutputs));
+   tvNull(&gcLastSync);
+   tvNull(&gcLastTick);
    active = no;
 
    gcReplayTimer = new QTimer();
@@ -133,104 +139,116 @@ void IoThread::stopGhostCar()
 
    gcReplayTimer->stop();
    usleep(200);
-   gcValues.clear();
-   gcValueIndex = 0;
+   gcProfile.clear();
+   gcAlignment.reset();
+   gcPosition = 0;
+   gcFrozen = no;
    gcPause = 0;
 
    ioDevice->stopGhostCar();
 }
 
-void IoThread::startGhostCar(char pwmBit, char iBit, int profileId)
+void IoThread::startGhostCar(char pwmBit, char iBit, const GcProfile& profile)
 {
-   GcValue value;
-   int count = 0;
-
-   gcValueIndex = 0;
-
-   QSqlQuery q("select VOLT, AMPERE from lap_profiles where PROFILE_ID = '" +
-               QString::number(profileId) + "' order by LAP_PROFILE_ID;");
+   gcPosition = 0;
+   gcFrozen = no;
+   gcAlignment.reset();
+   tvNull(&gcLastSync);
 
-   while (q.next())
-   {
-      gcValues.append(value);
+   // loaded in the background by the caller, the start must not wait for the database
 
-      value.volt = (byte)q.value(0).toInt();
-      value.ampere = (byte)q.value(1).toInt();
-      count++;
-   }
+   gcProfile = profile;
 
-   if (count)
+   if (!gcProfile.isEmpty())
    {
-      tell(eloAlways, "Starting ghost car with profile (%d)", profileId);
+      tell(eloAlways, "Starting ghost car");
 
       ioDevice->startGhostCar(pwmBit, iBit);
       gcPause = 0;
-      gcReplayTimer->start(20);
-      tell(eloAlways, "added %d values", count);
+      tvNow(&gcLastTick);
+      gcReplayTimer->start(getGcScale());
+      tell(eloAlways, "added %d values, recorded with %dms, replay with %dms",
+           gcProfile.getCount(), gcProfile.getScale(), getGcScale());
    }
    else
    {
-      tell(eloAlways, "No data for profile %d found", profileId);
+      tell(eloAlways, "No data for ghost car profile found");
    }
 }
 
 void IoThread::onReplayTimer()
 {
-   if (!gcValues.size())
-      return ;
+   GcProfile::Value value;
+   timeval now;
 
-   if (gcValueIndex == na)
+   if (gcProfile.isEmpty())
       return ;
 
+   // the replay position follows the real time scaled by the
+   // replay rate of the lap alignment
+
+   tvNow(&now);
+   double msec = elapsed(&gcLastTick, &now) / 1000.0;
+   gcLastTick = now;
+
    if (gcPause > 0)
    {
       gcPause--;
       return ;
    }
 
-   byte volt = gcValues.at(gcValueIndex).volt;
-   byte ampere = gcValues.at(gcValueIndex).ampere;
+   gcPosition += msec * gcAlignment.getRate();
 
-   // bei halten des Wertes am Ende der Liste
-   //  ... konservativ regeln
+   if (gcFrozen)
+      return ;
 
-   if (gcValueIndex == gcValues.size()-1)
-   {
-      tell(eloAlways, "'Freeze' last value until sync signal");
-      volt /= 2;
-      ampere /= 2;
+   // the profile is interpolated to the replay intervall of the device
 
-      if (volt < 100)
-         volt = 100;
-   }
+   if (gcProfile.valueAt(gcPosition, value) != success)
+   {
+      // bei halten des Wertes am Ende der Liste
+      //  ... konservativ regeln
 
-   tell(eloAlways, "[%04d] %d/%d", gcValueIndex, volt, ampere);
+      tell(eloAlways, "'Freeze' last value until sync signal");
+      value.volt /= 2;
+      value.ampere /= 2;
 
-   ioDevice->writeGhostCarValue(volt, ampere);
+      if (value.volt < 100)
+         value.volt = 100;
 
-   gcValueIndex++;
+      gcFrozen = yes;           // am letzen Wert halten (bis zum nchsten sync signal)
+   }
 
-   // am letzen Wert halten (bis zum nchsten sync signal)
+   TRACE(eloDebug, "[%6.0fms] %d/%d", gcPosition, value.volt, value.ampere);
 
-   if (gcValueIndex >= gcValues.size())
-      gcValueIndex = na;
+   ioDevice->writeGhostCarValue(value.volt, value.ampere);
 }
 
 //***************************************************************************
-//
+// Ghost Car Sync
+//  - lap signal of the ghost car, align the replay to the measured lap
 //***************************************************************************
 
-void IoThread::ghostCarSync()
+void IoThread::ghostCarSync(const timeval* tp)
 {
+   GcProfile::Value value;
+
+   if (gcLastSync.tv_sec)
+      gcAlignment.sync(gcProfile.getDuration(),
+                       elapsed(&gcLastSync, tp) / 1000.0, gcPosition);
+
+   gcLastSync = *tp;
+
    ioDevice->flushGhostCar();
-   gcValueIndex = 0;
+   gcPosition = 0;
+   gcFrozen = no;
    gcPause = 0;
+   tvNow(&gcLastTick);
 
-   ioDevice->writeGhostCarValue(gcValues.at(gcValueIndex).volt,
-                                gcValues.at(gcValueIndex).ampere);
-   gcValueIndex++;
+   if (gcProfile.valueAt(gcPosition, value) == success)
+      ioDevice->writeGhostCarValue(value.volt, value.ampere);
 
-   tell(eloAlways, "Sync gc to lap signal");
+   tell(eloAlways, "Sync gc to lap signal, replay rate (%.3f)", gcAlignment.getRate());
 }
 
 //***************************************************************************
@@ -267,6 +285,84 @@ int IoThread::checkAndOpenConnetion()
    return ioDevice->isOpen() ? success : fail;
 }
 
+//***************************************************************************
+// Write Bit
+//***************************************************************************
+
+int IoThread::writeBit(int bit, int value)
+{
+   int lane = 0;
+
+   for (int l = 0; l < journalLanes && bit >= 0 && bit < 32; l++)
+      if (laneOutputs[l] & (1u << bit))
+         lane = l + 1;
+
+   Journal::write(Journal::etOutput, lane, 0, bit, value);
+
+   return ioDevice->writeBit(bit, value);
+}
+
+//***************************************************************************
+// Set Journal Lanes
+//  - the bits of the lane related functions, to journal the digital
+//    events with their lane, call it after the bits are configured
+//***************************************************************************
+
+void IoThread::setJournalLanes()
+{
+   static const int inputs[] = { bitIrSlot1, bitFuelStartSlot1, bitFuelEndSlot1, na };
+   static const int outputs[] = { bitPowerIndSlot1, bitPowerSlot1, bitFuelingIndSlot1,
+                                  bitPenaltyIndSlot1, na };
+
+   for (int lane = 0; lane < journalLanes; lane++)
+   {
+      dword in = 0;
+      dword out = 0;
+
+      for (int i = 0; inputs[i] != na; i++)
+      {
+         int bit = inputBits[inputs[i] + lane].bit;
+
+         if (bit >= 0 && bit < 32)
+            in |= 1u << bit;
+      }
+
+      for (int i = 0; outputs[i] != na; i++)
+      {
+         int bit = outputBits[outputs[i] + lane].bit;
+
+         if (bit >= 0 && bit < 32)
+            out |= 1u << bit;
+      }
+
+      laneInputs[lane] = in;
+      laneOutputs[lane] = out;
+   }
+}
+
+//***************************************************************************
+// Journal Inputs
+//  - one record for the changed bits of each lane, the
+//    remaining ones (start and panic keys) without lane
+//***************************************************************************
+
+void IoThread::journalInputs(dword time, dword value, dword changed)
+{
+   dword left = changed;
+
+   for (int lane = 0; lane < journalLanes; lane++)
+   {
+      if (changed & laneInputs[lane])
+      {
+         Journal::write(Journal::etDigitalIn, lane+1, time, value, changed & laneInputs[lane]);
+         left &= ~laneInputs[lane];
+      }
+   }
+
+   if (left || !changed)
+      Journal::write(Journal::etDigitalIn, 0, time, value, left);
+}
+
 //***************************************************************************
 // Get Message
 //***************************************************************************
@@ -282,8 +378,6 @@ byte* IoThread::getMessage()
 
 void IoThread::control()
 {
-   char buf[100+TB];
-
    if (!active)
       return ;
 
@@ -305,7 +399,9 @@ void IoThread::control()
             event.value = input->value;
             event.tp = addMs2Tv(ioDevice->getBoardStartTime(), input->time);
 
-            tell(eloDebug, "Got digital input (%s)", toBinStr(input->value, buf));
+            TRACE(eloDebug, "Got digital input (%32b)", input->value);
+            journalInputs(input->time, input->value, input->value ^ lastInputs);
+            lastInputs = input->value;
 
             emit onDigitalInput(event);
          }
@@ -323,11 +419,76 @@ void IoThread::control()
             event.volt = input->volt;
             event.ampere = input->ampere;
 
+            Journal::write(Journal::etAnalogIn, 0, 0, input->volt | (input->ampere << 8));
+
             emit onAnalogInput(event);
          }
 
          break;
       }
+      case cGhostCarBlock:
+      {
+         QList<GcProfile::Value> values;
+         AnalogEvent event;
+
+         if (getMessage())
+         {
+            if (!GcProfile::decodeBlock((GhostCarBlock*)getMessage(), values))
+            {
+               tell(eloDetail, "<- end of ghost car recording");
+               emit onGhostCarRecorded();
+               break;
+            }
+
+            // the block carries no board time
+
+            for (int i = 0; i < values.size(); i++)
+            {
+               event.volt = values.at(i).volt;
+               event.ampere = values.at(i).ampere;
+
+               Journal::write(Journal::etAnalogIn, 0, 0, event.volt | (event.ampere << 8));
+
+               emit onAnalogInput(event);
+            }
+         }
+
+         break;
+      }
+      case cTelemetryBlock:
+      {
+         QList<GcProfile::Value> values;
+         TelemetryEvent event;
+         TelemetryBlock* block;
+
+         if (getMessage())
+         {
+            block = (TelemetryBlock*)getMessage();
+
+            if (block->lane < 1 || block->lane > telemetryLanes
+                || !GcProfile::decodeBlock(&block->block, values))
+               break;
+
+            event.slot = block->lane - 1;
+            event.tp = addMs2Tv(ioDevice->getBoardStartTime(), block->time);
+            event.count = values.size();
+
+            // the samples follow each other in the recording cycle
+
+            for (int i = 0; i < values.size(); i++)
+            {
+               event.volt[i] = values.at(i).volt;
+               event.ampere[i] = values.at(i).ampere;
+
+               Journal::write(Journal::etAnalogIn, block->lane, block->time + i * getGcScale(),
+                              event.volt[i] | (event.ampere[i] << 8));
+            }
+
+            emit onTelemetry(event);
+         }
+
+         break;
+      }
       case cDebug:
       {
          DebugValue* debug;
@@ -343,8 +504,8 @@ void IoThread::control()
       }
       case cGhostCarBufferFull:
       {
-         gcPause = 50;  // wait 0.5 seconds
-         gcValueIndex--;
+         gcPause = 500 / getGcScale();  // wait 0.5 seconds
+
          tell(eloDetail, "<- buffer full, waiting");
 
          break;
@@ -18,6 +18,7 @@
 
 #include <common.hpp>
 #include <iointerface.hpp>
+#include <gcprofile.hpp>
 
 class LinslotWindow;
 
@@ -31,6 +32,11 @@ class IoThread : public QThread, public SlotService, public IoService
 
    public:
 
+      enum Misc
+      {
+         journalLanes = 4
+      };
+
       // object
 
       IoThread();
@@ -44,7 +50,7 @@ class IoThread : public QThread, public SlotService, public IoService
       int close();
       void stop()                       { running = no; tell(eloDebug, "IO/Thread got stop signal"); }
       void setTestMode(int aFlag)       { testMode = aFlag; }
-      int writeBit(int bit, int value)  { return ioDevice->writeBit(bit, value); }
+      int writeBit(int bit, int value);
       int readOutBit(int bit)           { return ioDevice->readOutBit(bit); }
       int isOpen()                      { return ioDevice->isOpen(); }
       int flush()                       { return ioDevice->flush(); }
@@ -55,12 +61,17 @@ class IoThread : public QThread, public SlotService, public IoService
       byte* getMessage();
 
       int getGcScale()                  { return ioDevice->getGcScale(); }
+      dword boardTimeOf(const timeval* tp)
+      { timeval start = ioDevice->getBoardStartTime(); return elapsed(&start, tp) / 1000; }
       void recordGhostCar(char vBit, char iBit)  { return ioDevice->recordGhostCar(vBit, iBit); }
-      void startGhostCar(char pwmBit, char iBit, int profileId);
+      void recordTelemetry(int cycle, const char* vBits, const char* iBits)
+      { ioDevice->recordTelemetry(cycle, vBits, iBits); }
+      void startGhostCar(char pwmBit, char iBit, const GcProfile& profile);
       void stopGhostCar();
-      void ghostCarSync();
+      void ghostCarSync(const timeval* tp);
       void initIoSetup(word bitsInput, word bitsOutput, byte withSpi)
       { ioDevice->initIoSetup(bitsInput, bitsOutput, withSpi); }
+      void setJournalLanes();
 
       // get / set
 
@@ -71,6 +82,8 @@ class IoThread : public QThread, public SlotService, public IoService
 
       void onDigitalInput(const DigitalEvent &ioEvent);
       void onAnalogInput(const AnalogEvent &ioEvent);
+      void onTelemetry(const TelemetryEvent &ioEvent);
+      void onGhostCarRecorded();
       void onDeviceConnected(int state);
 
    private slots:
@@ -79,27 +92,29 @@ class IoThread : public QThread, public SlotService, public IoService
 
    protected:
 
-      struct GcValue
-      {
-         byte volt;
-         byte ampere;
-      };
-
       void run();
       int checkAndOpenConnetion();
+      void journalInputs(dword time, dword value, dword changed);
 
       // data
 
       int gcPause;
       QTimer* gcReplayTimer;
-      int gcValueIndex;
-      QList<GcValue> gcValues;
+      double gcPosition;             // replay position in the profile [ms]
+      int gcFrozen;                  // end of profile reached before lap signal
+      timeval gcLastTick;
+      timeval gcLastSync;
+      GcProfile gcProfile;
+      GcAlignment gcAlignment;
       char device[100+TB];
       int testMode;
       IoInterface* ioDevice;
       int running;
       byte command;
       int active;
+      dword lastInputs;              // for the changed bits in the journal
+      dword laneInputs[journalLanes];    // input bits of each lane
+      dword laneOutputs[journalLanes];   // output bits of each lane
 };
 
 //***************************************************************************
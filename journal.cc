@@ -0,0 +1,420 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File journal.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+#include <QDir>
+#include <QStringList>
+#include <QMutex>
+#include <QList>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <common.hpp>
+#include <journal.hpp>
+
+//***************************************************************************
+// Globals
+//***************************************************************************
+
+int Journal::active = no;
+Journal::Header* Journal::header = 0;
+Journal::Record* Journal::records = 0;
+size_t Journal::mapSize = 0;
+
+struct JournalPart
+{
+   Journal::Header* header;
+   char path[300+TB];
+};
+
+static QMutex journalMutex;
+static char journalDir[255+TB] = "";
+static char journalSession[50+TB] = "";
+static char journalPath[300+TB] = "";
+static int64_t journalStart = 0;
+static uint32_t journalRecords = 0;
+static uint32_t journalPart = 0;
+static uint32_t journalSequence = 0;
+static uint32_t journalLost = 0;             // records lost waiting for the next part
+static int journalFiles = 0;
+static JournalPart journalNext = { 0, "" };  // prepared by the worker
+static QList<JournalPart> journalFinished;   // to be closed and cut by the worker
+
+//***************************************************************************
+// Class Journal Worker
+//  - prepares the next part and closes, cuts and removes the finished
+//    ones, the state is protected by the journal's mutex
+//***************************************************************************
+
+class JournalWorker : public QThread
+{
+   public:
+
+      JournalWorker()               { running = yes; }
+
+      void stop();
+      void wakeUp()                 { pending.wakeOne(); }   // mutex locked by the caller
+
+   protected:
+
+      void run();
+
+      int running;
+      QWaitCondition pending;
+};
+
+static JournalWorker* journalWorker = 0;
+
+void JournalWorker::stop()
+{
+   journalMutex.lock();
+   running = no;
+   pending.wakeOne();
+   journalMutex.unlock();
+
+   wait();
+}
+
+//***************************************************************************
+// Run
+//***************************************************************************
+
+void JournalWorker::run()
+{
+   char path[300+TB];
+   uint32_t part;
+
+   Journal::removeOld();
+
+   journalMutex.lock();
+
+   for (;;)
+   {
+      // the finished parts first, also after stop
+
+      if (!journalFinished.isEmpty())
+      {
+         JournalPart finished = journalFinished.takeFirst();
+
+         journalMutex.unlock();
+         Journal::cutPart(finished.path, Journal::closePart(finished.header, no));
+         Journal::removeOld();
+         journalMutex.lock();
+
+         continue;
+      }
+
+      if (!running)
+         break;
+
+      if (!journalNext.header)
+      {
+         Journal::Header* next;
+
+         part = journalPart + 1;
+         snprintf(path, 300, "%s/%s-%03u.lsj", journalDir, journalSession, part);
+
+         journalMutex.unlock();
+         next = Journal::createPart(path, part);
+         journalMutex.lock();
+
+         if (next)
+         {
+            journalNext.header = next;
+            strcpy(journalNext.path, path);
+         }
+         else if (running)
+         {
+            pending.wait(&journalMutex, 5000);   // try again
+         }
+
+         continue;
+      }
+
+      pending.wait(&journalMutex);
+   }
+
+   journalMutex.unlock();
+}
+
+//***************************************************************************
+// Open
+//  - starts a new session
+//***************************************************************************
+
+int Journal::open(const char* dir, int recordCount, int files)
+{
+#ifdef _WIN32
+   return fail;
+#else
+   QMutexLocker lock(&journalMutex);
+   timeval tp;
+   struct tm tm;
+
+   if (active)
+      return done;
+
+   if (mkdir(dir, 0755) < 0 && errno != EEXIST)
+   {
+      tell(eloAlways, "Error: Creating journal directory '%s' failed, %s", dir, strerror(errno));
+      return fail;
+   }
+
+   gettimeofday(&tp, 0);
+   localtime_r(&tp.tv_sec, &tm);
+   strftime(journalSession, 50, "%Y%m%d-%H%M%S", &tm);
+
+   snprintf(journalDir, 255, "%s", dir);
+   journalStart = tp.tv_sec * 1000000LL + tp.tv_usec;
+   journalRecords = recordCount;
+   journalFiles = files;
+   journalPart = 0;
+   journalSequence = 0;
+   journalLost = 0;
+   mapSize = sizeof(Header) + journalRecords * sizeof(Record);
+
+   snprintf(journalPath, 300, "%s/%s-%03u.lsj", journalDir, journalSession, journalPart);
+
+   if (!(header = createPart(journalPath, journalPart)))
+      return fail;
+
+   records = (Record*)((char*)header + sizeof(Header));
+   active = yes;
+
+   journalWorker = new JournalWorker();
+   journalWorker->start();
+
+   return success;
+#endif
+}
+
+//***************************************************************************
+// Close
+//***************************************************************************
+
+void Journal::close()
+{
+   journalMutex.lock();
+   active = no;
+   journalMutex.unlock();
+
+   // the worker finishes the parts switched before
+
+   if (journalWorker)
+   {
+      journalWorker->stop();
+      delete journalWorker;
+      journalWorker = 0;
+   }
+
+   QMutexLocker lock(&journalMutex);
+
+   if (journalLost)
+      tell(eloAlways, "Warning: Journal lost (%u) records waiting for the next part", journalLost);
+
+   while (!journalFinished.isEmpty())
+   {
+      JournalPart finished = journalFinished.takeFirst();
+      cutPart(finished.path, closePart(finished.header, no));
+   }
+
+   if (journalNext.header)
+   {
+      closePart(journalNext.header, no);
+      unlink(journalNext.path);
+      journalNext.header = 0;
+   }
+
+   if (!records)
+      return ;
+
+   records = 0;
+   cutPart(journalPath, closePart(header, yes));
+   header = 0;
+}
+
+//***************************************************************************
+// Create Part
+//  - no lock needed, the new part isn't seen until it's returned
+//***************************************************************************
+
+Journal::Header* Journal::createPart(const char* path, uint32_t part)
+{
+#ifdef _WIN32
+   return 0;
+#else
+   Header* h;
+   void* map;
+   int fd;
+
+   if ((fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+   {
+      tell(eloAlways, "Error: Opening journal '%s' failed, %s", path, strerror(errno));
+      return 0;
+   }
+
+   if (ftruncate(fd, mapSize) < 0)
+   {
+      ::close(fd);
+      return 0;
+   }
+
+   map = mmap(0, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   ::close(fd);
+
+   if (map == MAP_FAILED)
+      return 0;
+
+   // the new file is zero filled, so all records are unused
+
+   h = (Header*)map;
+
+   strcpy(h->magic, "LSJOURN");
+   h->version = version;
+   h->recordCount = journalRecords;
+   h->recordSize = sizeof(Record);
+   h->part = part;
+   h->used = 0;
+   h->sessionStart = journalStart;
+
+   tell(eloDetail, "Journal '%s' created", path);
+
+   return h;
+#endif
+}
+
+//***************************************************************************
+// Close Part
+//  - returns the used records, the part isn't used by anyone else anymore
+//  - only the last part is synced ('sync'), the ones switched while
+//    running are only scheduled for writing
+//***************************************************************************
+
+uint32_t Journal::closePart(Header* part, int sync)
+{
+   uint32_t used = 0;
+
+#ifndef _WIN32
+   used = part->used;
+   part->recordCount = used;
+
+   msync(part, mapSize, sync ? MS_SYNC : MS_ASYNC);
+   munmap(part, mapSize);
+#endif
+
+   return used;
+}
+
+//***************************************************************************
+// Cut Part
+//  - the unused records of a closed part are cut off, no lock needed
+//***************************************************************************
+
+void Journal::cutPart(const char* path, uint32_t used)
+{
+#ifndef _WIN32
+   if (truncate(path, sizeof(Header) + used * sizeof(Record)) < 0)
+      tell(eloAlways, "Warning: Truncating journal '%s' failed, %s", path, strerror(errno));
+#endif
+}
+
+//***************************************************************************
+// Remove Old
+//  - the names sort by time, keep the newest 'journalFiles'
+//***************************************************************************
+
+void Journal::removeOld()
+{
+   QDir dir(journalDir);
+   QStringList files = dir.entryList(QStringList() << "*.lsj", QDir::Files, QDir::Name);
+
+   for (int i = 0; i < files.size() - journalFiles; i++)
+   {
+      tell(eloDetail, "Removing old journal '%s'", files.at(i).toAscii().constData());
+      dir.remove(files.at(i));
+   }
+}
+
+//***************************************************************************
+// Write
+//***************************************************************************
+
+void Journal::write(int type, int lane, uint32_t boardTime, uint32_t value, uint32_t extra)
+{
+   timeval tp;
+   Record* r;
+
+   if (!active)
+      return ;
+
+   QMutexLocker lock(&journalMutex);
+
+   if (!active || !records)
+      return ;
+
+   // part full -> switch to the prepared one, the worker does the file work
+
+   if (header->used >= header->recordCount)
+   {
+      JournalPart finished;
+
+      if (!journalNext.header)
+      {
+         journalLost++;              // the worker is late
+         return ;
+      }
+
+      finished.header = header;
+      strcpy(finished.path, journalPath);
+      journalFinished.append(finished);
+
+      header = journalNext.header;
+      records = (Record*)((char*)header + sizeof(Header));
+      strcpy(journalPath, journalNext.path);
+      journalNext.header = 0;
+      journalPart++;
+
+      journalWorker->wakeUp();
+
+      if (journalLost)
+      {
+         tell(eloAlways, "Warning: Journal lost (%u) records waiting for the next part", journalLost);
+         journalLost = 0;
+      }
+   }
+
+   gettimeofday(&tp, 0);
+
+   r = &records[header->used];
+
+   r->type = type;
+   r->lane = lane;
+   r->boardTime = boardTime;
+   r->hostTime = tp.tv_sec * 1000000LL + tp.tv_usec;
+   r->value = value;
+   r->extra = extra;
+   r->sequence = ++journalSequence;  // valid from now on
+
+   header->used++;
+}
@@ -0,0 +1,125 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File journal.hpp
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+#ifndef _JOURNAL_H_
+#define _JOURNAL_H_
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <stdint.h>
+#include <stddef.h>
+
+//***************************************************************************
+// Class Journal
+//  - every i/o event with board and host time, for the analysis of
+//    disputed laps and bouncing contacts after the race ('journaldump')
+//  - one file per session and part: <dir>/<yyyymmdd-hhmmss>-<part>.lsj,
+//    layout Header | Record[recordCount], the file is memory mapped
+//  - a full part is switched to the next one, which is prepared by a
+//    worker thread, the worker also cuts the finished parts and keeps
+//    only the newest 'maxFiles' files (no file work in the io thread)
+//  - written by the io and the gui thread, serialized by a mutex
+//***************************************************************************
+
+class Journal
+{
+   friend class JournalWorker;
+
+   public:
+
+      enum Misc
+      {
+         version = 1,
+         defaultRecords = 131072,     // 4 MB per part
+         defaultFiles = 20
+      };
+
+      enum EventType
+      {
+         etDigitalIn = 1,             // value: inputs, extra: changed bits (of the lane)
+         etAnalogIn,                  // value: volt | ampere << 8
+         etOutput,                    // value: bit, extra: state, lane of the bit's function
+         etSignal,                    // lap signal of a lane, before any check
+         etLap,                       // counted lap, value: lap, extra: lap time [us]
+         etFuel,                      // value: start (1) or end (0) of fueling
+         etRace,                      // value: race state (see RaceEvent)
+
+         etCount
+      };
+
+      enum RaceEvent
+      {
+         reStart = 1,
+         reFinish,
+         reAbort
+      };
+
+#pragma pack(1)
+
+      struct Header                   // 64 byte
+      {
+         char magic[8];               // "LSJOURN"
+         uint32_t version;
+         uint32_t recordCount;
+         uint32_t recordSize;
+         uint32_t part;               // of the session, 0..
+         uint32_t used;               // records written
+         uint32_t reserved0;
+         int64_t sessionStart;        // wall clock [us]
+         uint8_t reserved[24];
+      };
+
+      struct Record                   // 32 byte
+      {
+         uint32_t sequence;           // 1.. over all parts of the session, 0 for unused
+         uint8_t type;
+         uint8_t lane;                // 1.., 0 if not lane related
+         uint16_t reserved;
+         uint32_t boardTime;          // board clock [ms], 0 if the event has none
+         int64_t hostTime;            // wall clock when journaled [us]
+         uint32_t value;
+         uint32_t extra;
+         uint32_t reserved1;
+      };
+
+#pragma pack()
+
+      // interface
+
+      static int open(const char* dir, int records = defaultRecords, int files = defaultFiles);
+      static void close();
+      static int isActive()          { return active; }
+
+      static void write(int type, int lane, uint32_t boardTime, uint32_t value, uint32_t extra = 0);
+
+      // also used by the reader
+
+      static const char* typeName(int type)
+      {
+         static const char* names[etCount] = { "-", "DIN", "AIN", "OUT", "SIGNAL", "LAP", "FUEL", "RACE" };
+
+         return type > 0 && type < etCount ? names[type] : "?";
+      }
+
+   protected:
+
+      static Header* createPart(const char* path, uint32_t part);
+      static uint32_t closePart(Header* part, int sync);
+      static void cutPart(const char* path, uint32_t used);
+      static void removeOld();
+
+      static int active;             // open, also while switching to the next part
+      static Header* header;
+      static Record* records;
+      static size_t mapSize;
+};
+
+//***************************************************************************
+#endif // _JOURNAL_H_
@@ -0,0 +1,330 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File journaldump.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// HOWTO build
+//***************************************************************************
+
+// g++ -ggdb -I. -I/usr/include/qt4 -I/usr/include/qt4/QtCore journaldump.cc -o journaldump
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <common.hpp>
+#include <journal.hpp>
+
+//***************************************************************************
+// Options
+//***************************************************************************
+
+static int lane = na;
+static int type = na;
+static const char* fromArg = 0;
+static const char* untilArg = 0;
+static unsigned int bounceMs = 0;
+
+// last change of each input bit [board ms], over all files
+
+static uint32_t lastChange[32];
+static int haveChange[32];
+
+//***************************************************************************
+// Time Of Day
+//  - 'hh:mm[:ss[.mmm]]' on the day of 'reference' to wall clock [us]
+//***************************************************************************
+
+static int64_t timeOfDay(const char* arg, int64_t reference)
+{
+   int h = 0, m = 0, s = 0, ms = 0;
+   time_t t = reference / 1000000;
+   struct tm tm;
+
+   if (sscanf(arg, "%d:%d:%d.%d", &h, &m, &s, &ms) < 2)
+      return na;
+
+   localtime_r(&t, &tm);
+   tm.tm_hour = h;
+   tm.tm_min = m;
+   tm.tm_sec = s;
+   tm.tm_isdst = -1;
+
+   return mktime(&tm) * 1000000LL + ms * 1000LL;
+}
+
+//***************************************************************************
+// First Record At
+//  - binary search, the records are written in order of the host time
+//***************************************************************************
+
+static bool beforeTime(const Journal::Record& r, int64_t t)
+{
+   return r.hostTime < t;
+}
+
+//***************************************************************************
+// Show
+//***************************************************************************
+
+static void trackChanges(const Journal::Record* r)
+{
+   for (int bit = 0; bit < 32; bit++)
+   {
+      if (r->extra & (1u << bit))
+      {
+         lastChange[bit] = r->boardTime;
+         haveChange[bit] = yes;
+      }
+   }
+}
+
+static void show(const Journal::Record* r)
+{
+   char date[50+TB];
+   char info[200+TB] = "";
+   time_t sec = r->hostTime / 1000000;
+   struct tm tm;
+
+   localtime_r(&sec, &tm);
+   strftime(date, 50, "%y.%m.%d %H:%M:%S", &tm);
+
+   switch (r->type)
+   {
+      case Journal::etDigitalIn:
+      {
+         unsigned int minDelta = 0xFFFFFFFF;
+
+         // time since the last change of the bits changed now
+
+         for (int bit = 0; bit < 32; bit++)
+         {
+            if (!(r->extra & (1u << bit)))
+               continue;
+
+            if (haveChange[bit] && r->boardTime - lastChange[bit] < minDelta)
+               minDelta = r->boardTime - lastChange[bit];
+
+            lastChange[bit] = r->boardTime;
+            haveChange[bit] = yes;
+         }
+
+         if (minDelta != 0xFFFFFFFF)
+            sprintf(info, "inputs 0x%08x changed 0x%08x after %u ms%s",
+                    r->value, r->extra, minDelta, minDelta < bounceMs ? "  <- bounce?" : "");
+         else
+            sprintf(info, "inputs 0x%08x changed 0x%08x", r->value, r->extra);
+
+         break;
+      }
+      case Journal::etAnalogIn:
+         sprintf(info, "volt %u ampere %u", r->value & 0xFF, (r->value >> 8) & 0xFF);
+         break;
+      case Journal::etOutput:
+         sprintf(info, "bit %u -> %u", r->value, r->extra);
+         break;
+      case Journal::etSignal:
+         sprintf(info, "signal");
+         break;
+      case Journal::etLap:
+         sprintf(info, "lap %u  %u.%06u s", r->value, r->extra / 1000000, r->extra % 1000000);
+         break;
+      case Journal::etFuel:
+         sprintf(info, "fueling %s", r->value ? "start" : "end");
+         break;
+      case Journal::etRace:
+         sprintf(info, "%s", r->value == Journal::reStart ? "start"
+                 : r->value == Journal::reFinish ? "finish" : "abort");
+         break;
+   }
+
+   printf("%s,%6.6lld %10u %-6s %c %s\n", date, (long long)(r->hostTime % 1000000),
+          r->boardTime, Journal::typeName(r->type), r->lane ? '0' + r->lane : '-', info);
+}
+
+//***************************************************************************
+// Dump File
+//***************************************************************************
+
+static int dumpFile(const char* path)
+{
+   const Journal::Header* header;
+   const Journal::Record* records;
+   unsigned int count;
+   struct stat st;
+   void* map;
+   int fd;
+   int shown = 0;
+
+   if ((fd = open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+   {
+      printf("Can't open '%s', %s\n", path, strerror(errno));
+      return fail;
+   }
+
+   map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+
+   if (map == MAP_FAILED || (size_t)st.st_size < sizeof(Journal::Header))
+   {
+      printf("Can't map '%s'\n", path);
+      return fail;
+   }
+
+   header = (const Journal::Header*)map;
+
+   if (memcmp(header->magic, "LSJOURN", 8) != 0 || header->version != Journal::version
+       || header->recordSize != sizeof(Journal::Record))
+   {
+      printf("'%s' is not a journal of this version\n", path);
+      munmap(map, st.st_size);
+      return fail;
+   }
+
+   records = (const Journal::Record*)((const char*)map + sizeof(Journal::Header));
+   count = std::min(header->used, header->recordCount);
+   count = std::min(count, (unsigned int)((st.st_size - sizeof(Journal::Header)) / sizeof(Journal::Record)));
+
+   // a crash may leave the last record unfinished
+
+   while (count && !records[count-1].sequence)
+      count--;
+
+   const Journal::Record* first = records;
+   const Journal::Record* last = records + count;
+
+   if (fromArg)
+      first = std::lower_bound(records, last, timeOfDay(fromArg, header->sessionStart), beforeTime);
+
+   if (untilArg)
+      last = std::lower_bound(first, last, timeOfDay(untilArg, header->sessionStart) + 1, beforeTime);
+
+   printf("-- %s, part %u, %u records\n", path, header->part, count);
+
+   for (const Journal::Record* r = first; r < last; r++)
+   {
+      if ((type != na && r->type != type) || (lane != na && r->lane != lane))
+      {
+         // the changes of the inputs are tracked even if not shown
+
+         if (r->type == Journal::etDigitalIn)
+            trackChanges(r);
+
+         continue;
+      }
+
+      show(r);
+      shown++;
+   }
+
+   printf("-- %d records shown\n", shown);
+   munmap(map, st.st_size);
+
+   return success;
+}
+
+//***************************************************************************
+// Main
+//***************************************************************************
+
+int main(int argc, char** argv)
+{
+   std::vector<std::string> files;
+   int c;
+
+   while ((c = getopt(argc, argv, "l:t:f:u:b:h")) != -1)
+   {
+      switch (c)
+      {
+         case 'l': lane = atoi(optarg);      break;
+         case 'f': fromArg = optarg;         break;
+         case 'u': untilArg = optarg;        break;
+         case 'b': bounceMs = atoi(optarg);  break;
+         case 't':
+         {
+            for (int t = 1; t < Journal::etCount; t++)
+               if (strcasecmp(optarg, Journal::typeName(t)) == 0)
+                  type = t;
+
+            if (type == na)
+            {
+               printf("Unknown type '%s'\n", optarg);
+               return 1;
+            }
+
+            break;
+         }
+         default:
+         {
+            printf("Usage: journaldump [options] <file|directory> ...\n");
+            printf("       -l <lane>      events of this lane only (1, 2)\n");
+            printf("       -t <type>      events of this type only (DIN, AIN, OUT, SIGNAL, LAP, FUEL, RACE)\n");
+            printf("       -f <hh:mm:ss>  from this time\n");
+            printf("       -u <hh:mm:ss>  until this time\n");
+            printf("       -b <ms>        mark input changes faster than this (bouncing)\n");
+            return 1;
+         }
+      }
+   }
+
+   if (optind >= argc)
+   {
+      printf("Usage: journaldump [options] <file|directory> ...\n");
+      return 1;
+   }
+
+   // a directory stands for its journals, the names sort by time
+
+   for (int i = optind; i < argc; i++)
+   {
+      struct stat st;
+
+      if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode))
+      {
+         std::vector<std::string> names;
+         DIR* dir = opendir(argv[i]);
+         dirent* entry;
+
+         while (dir && (entry = readdir(dir)))
+         {
+            size_t len = strlen(entry->d_name);
+
+            if (len > 4 && strcmp(entry->d_name + len - 4, ".lsj") == 0)
+               names.push_back(std::string(argv[i]) + "/" + entry->d_name);
+         }
+
+         if (dir)
+            closedir(dir);
+
+         std::sort(names.begin(), names.end());
+         files.insert(files.end(), names.begin(), names.end());
+      }
+      else
+         files.push_back(argv[i]);
+   }
+
+   for (size_t i = 0; i < files.size(); i++)
+      dumpFile(files[i].c_str());
+
+   return 0;
+}
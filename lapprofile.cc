@@ -10,7 +10,6 @@
 // Include
 //***************************************************************************
 
-#include <QSqlQuery>
 #include <QDialog>
 #include <QGridLayout>
 #include <QLineEdit>
@@ -35,14 +34,58 @@ RenderArea::RenderArea(QWidget* parent)
 
    xScale = 10;         // pixel / 100ms
    xStart = 0;          // start time of x axis in seconds
+   geometryScale = na;
+   geometryStart = na;
    model = 0;
+   dbService = 0;
    editDialog = 0;
    tableView = 0;
-   gcScale = 100.0;
 
    showVolt = showAmpere = showPower = yes;
 }
 
+//***************************************************************************
+// Reload
+//  - fill the model with the profiles, the queries of this view are
+//    submitted to the db service and answered by the on..Loaded() slots
+//***************************************************************************
+
+int RenderArea::reload()
+{
+   if (!model || !dbService)
+      return fail;
+
+   dbService->submit(new DbQuery("select PROFILE_ID, NAME, COURSE, LAP_LENGTH from profiles order by NAME;"),
+                     this, "onProfilesLoaded");
+
+   return success;
+}
+
+void RenderArea::onProfilesLoaded(DbJob* job)
+{
+   DbQuery* query = (DbQuery*)job;
+   QStringList header;
+
+   if (query->getStatus() != success)
+      return ;
+
+   header << "Id" << "Name" << "Strecke" << "Lnge";
+
+   model->clear();
+   model->setColumnCount(header.size());
+   model->setHorizontalHeaderLabels(header);
+
+   for (int row = 0; row < query->getRowCount(); row++)
+   {
+      QList<QStandardItem*> items;
+
+      for (int col = 0; col < query->getColumnCount(); col++)
+         items << new QStandardItem(query->value(row, col).toString());
+
+      model->appendRow(items);
+   }
+}
+
 //***************************************************************************
 // Scale X Axis
 //***************************************************************************
@@ -125,18 +168,25 @@ void RenderArea::getColor(bool)
 
 void RenderArea::editClicked(bool)
 {
-   QColor color;
    int row = tableView->currentIndex().row();
-   int profileId = model->index(row, model->fieldIndex("PROFILE_ID")).data().toInt();
+   DbQuery* query = new DbQuery("select NAME, COLOR, ACTIVE, PROFILE_ID from profiles where PROFILE_ID = ?;");
+
+   query->bind(model->index(row, colId).data().toInt());
+   dbService->submit(query, this, "onEditLoaded");
+}
 
-   QSqlQuery query("select NAME, COLOR, ACTIVE from profiles where PROFILE_ID = '" + 
-               QString::number(profileId) + "';");
+void RenderArea::onEditLoaded(DbJob* job)
+{
+   DbQuery* query = (DbQuery*)job;
+   QColor color;
 
-   query.next();
+   if (query->getStatus() != success || !query->getRowCount())
+      return ;
 
-   QString name = query.value(0).toString();
-   QString colorName = query.value(1).toString();
-   int checked = query.value(2).toBool();
+   QString name = query->value(0, 0).toString();
+   QString colorName = query->value(0, 1).toString();
+   int checked = query->value(0, 2).toBool();
+   int profileId = query->value(0, 3).toInt();
 
    color.setNamedColor(colorName);
 
@@ -180,13 +230,18 @@ void RenderArea::editClicked(bool)
    {
       tell(eloAlways, "accepted");
 
-      QSqlQuery query("update profiles set "
-                      "NAME = '" + nameEdit->text() + "', " 
-                      "ACTIVE = '" + (checkBoxActive->isChecked() ? "true" : "false") + "', " 
-                      "COLOR = '" + colorButton->palette().color(QPalette::Button).name() + "' "
-                      "where PROFILE_ID = " + QString::number(profileId) + ";");
+      DbQuery* update = new DbQuery("update profiles set NAME = ?, ACTIVE = ?, COLOR = ? "
+                                    "where PROFILE_ID = ?;");
+
+      update->bind(nameEdit->text())
+         .bind(checkBoxActive->isChecked() ? "true" : "false")
+         .bind(colorButton->palette().color(QPalette::Button).name())
+         .bind(profileId);
 
-      model->select();
+      // the jobs are executed in order, reload() reads the update
+
+      dbService->submit(update);
+      reload();
    }
 
    delete editDialog;
@@ -199,21 +254,21 @@ void RenderArea::editClicked(bool)
 void RenderArea::removeClicked(bool)
 {
    int row = tableView->currentIndex().row();
-   int profileId = model->index(row, model->fieldIndex("PROFILE_ID")).data().toInt();
-   QString name = model->index(row, model->fieldIndex("NAME")).data().toString();
+   int profileId = model->index(row, colId).data().toInt();
+   QString name = model->index(row, colName).data().toString();
 
    if (QMessageBox::question(this, "Lschen", "'" + name + "' lschen?",
                              QMessageBox::Yes, QMessageBox::No) == QMessageBox::Yes)
    {
-      QSqlQuery query;
+      DbQuery* profile = new DbQuery("delete from profiles where PROFILE_ID = ?;");
+      DbQuery* values = new DbQuery("delete from lap_profiles where PROFILE_ID = ?;");
 
-      query.exec("delete from profiles where PROFILE_ID = " 
-                 + QString::number(profileId) + ";");
-      
-      query.exec("delete from lap_profiles where PROFILE_ID = " 
-                 + QString::number(profileId) + ";");
+      profile->bind(profileId);
+      values->bind(profileId);
 
-      model->select();
+      dbService->submit(values);
+      dbService->submit(profile);
+      reload();
    }
 }
 
@@ -223,18 +278,8 @@ void RenderArea::removeClicked(bool)
 
 void RenderArea::doubleClicked(const QModelIndex& index)
 {
-   Line line;
-   int count = 0;
-
-   int profileId = model->index(index.row(), model->fieldIndex("PROFILE_ID")).data().toInt();
-
-   QSqlQuery query("select NAME, COLOR from profiles where PROFILE_ID = '" + 
-               QString::number(profileId) + "';");
-
-   query.next();
-
-   QString name = query.value(0).toString();
-   QString colorName = query.value(1).toString();
+   int profileId = model->index(index.row(), colId).data().toInt();
+   QString name = model->index(index.row(), colName).data().toString();
 
    // already in list .. ?
 
@@ -250,20 +295,59 @@ void RenderArea::doubleClicked(const QModelIndex& index)
       }
    }
 
-   // add to drwaing list
+   // add to drwaing list, the profile with its values in one query
 
-   QSqlQuery q("select VOLT, AMPERE from lap_profiles where PROFILE_ID = '" + 
-               QString::number(profileId) + "';");
+   DbQuery* query = new DbQuery("select p.NAME, p.COLOR, ifnull(p.SCALE, 100), l.VOLT, l.AMPERE "
+                                "from profiles p, lap_profiles l "
+                                "where p.PROFILE_ID = ? and l.PROFILE_ID = p.PROFILE_ID "
+                                "order by l.SEQUENCE;");
+   query->bind(profileId);
+   dbService->submit(query, this, "onLineLoaded");
+}
+
+void RenderArea::onLineLoaded(DbJob* job)
+{
+   DbQuery* query = (DbQuery*)job;
+   Line line;
+   int count = 0;
+
+   line.valid = no;
+
+   if (query->getStatus() != success || !query->getRowCount())
+      return ;
+
+   QString name = query->value(0, 0).toString();
+   QString colorName = query->value(0, 1).toString();
+   line.scale = qMax(query->value(0, 2).toInt(), 1);
+
+   // double clicked again while loading
+
+   for (int l = 0; l < lines.size(); l++)
+   {
+      if (lines.at(l).name == name)
+         return ;
+   }
+
+   // scaled to percent once, not on every paint
 
-   while (q.next())
+   for (int c = 0; c < cvCount; c++)
+      line.values[c].reserve(query->getRowCount());
+
+   for (int row = 0; row < query->getRowCount(); row++)
    {
-      line.volts.append(q.value(0).toInt());
-      line.amperes.append(q.value(1).toInt());
+      int volt = query->value(row, 3).toInt();
+      int ampere = query->value(row, 4).toInt();
+      double p = volt * ampere;
+
+      line.values[cvVolt].append((int)((double)volt / 255.0 * 100.0));
+      line.values[cvAmpere].append((int)((double)ampere / 255.0 * 100.0));
+      line.values[cvPower].append((int)(p / 255.0 * 100.0) / 150);  // 150 -> scale to fit window
       count++;
    }
 
    if (count)
    {
+      buildLevels(&line);
       line.color.setNamedColor(colorName);
       
       line.name = name;
@@ -317,6 +401,139 @@ void RenderArea::paintYAxis()
 }
 
 
+//***************************************************************************
+// Build Levels
+//  - each level halves the one below, min and max of two buckets,
+//    built once when the profile is loaded
+//***************************************************************************
+
+void RenderArea::buildLevels(Line* line)
+{
+   line->levels.clear();
+
+   while (yes)
+   {
+      int size = line->levels.isEmpty() ? line->values[cvVolt].size()
+         : line->levels.last().min[cvVolt].size();
+
+      if (size < 2)
+         break;
+
+      Level level;
+
+      for (int c = 0; c < cvCount; c++)
+      {
+         const QVector<int>& min = line->levels.isEmpty() ? line->values[c] : line->levels.last().min[c];
+         const QVector<int>& max = line->levels.isEmpty() ? line->values[c] : line->levels.last().max[c];
+
+         level.min[c].resize((size+1) / 2);
+         level.max[c].resize((size+1) / 2);
+
+         for (int i = 0; i < size; i += 2)
+         {
+            int n = qMin(i+1, size-1);
+
+            level.min[c][i/2] = qMin(min.at(i), min.at(n));
+            level.max[c][i/2] = qMax(max.at(i), max.at(n));
+         }
+      }
+
+      line->levels.append(level);
+   }
+}
+
+//***************************************************************************
+// Build Geometry
+//  - one point per pixel column as long as there are less samples than
+//    pixels, otherwise the min and max of the column, the buckets are read
+//    from the highest level that is still finer than a pixel
+//***************************************************************************
+
+void RenderArea::buildGeometry(Line* line)
+{
+   int iOff = (int)(xStart * 1000.0 / line->scale);
+   double xDiff = (double)xScale * (line->scale / 100.0);
+   int level = 0;
+   int column = na;
+   int minV[cvCount];
+   int maxV[cvCount];
+   int minFirst[cvCount];
+
+   while (level < line->levels.size() && (2 << level) * xDiff <= 1.0)
+      level++;
+
+   const QVector<int>* min = level ? line->levels.at(level-1).min : line->values;
+   const QVector<int>* max = level ? line->levels.at(level-1).max : line->values;
+   int buckets = min[cvVolt].size();
+
+   for (int c = 0; c < cvCount; c++)
+   {
+      line->polygons[c].clear();
+      line->polygons[c].reserve(2 * qMin(buckets, xWidth) + 2);
+      line->polygons[c].append(QPoint(xNull, yNull));
+   }
+
+   line->valid = yes;
+
+   for (int b = iOff >> level; b <= buckets; b++)
+   {
+      int x = b < buckets ? xNull + (int)((qMax(b << level, iOff) - iOff + 1) * xDiff) : na;
+
+      // next column, flush the last one
+
+      if (x != column && column != na)
+      {
+         for (int c = 0; c < cvCount; c++)
+         {
+            int yMin = yNull - minV[c] * yScale;
+            int yMax = yNull - maxV[c] * yScale;
+
+            if (yMin == yMax)
+               line->polygons[c].append(QPoint(column, yMin));
+            else if (minFirst[c])
+               line->polygons[c] << QPoint(column, yMin) << QPoint(column, yMax);
+            else
+               line->polygons[c] << QPoint(column, yMax) << QPoint(column, yMin);
+         }
+
+         if (column > xNull + xWidth)
+            break;
+      }
+
+      if (x == na)
+         break;
+
+      for (int c = 0; c < cvCount; c++)
+      {
+         int lo = min[c].at(b);
+         int hi = max[c].at(b);
+
+         if (x != column)
+         {
+            minV[c] = lo;
+            maxV[c] = hi;
+            minFirst[c] = yes;
+         }
+         else
+         {
+            if (lo < minV[c])
+            {
+               minV[c] = lo;
+               minFirst[c] = no;
+            }
+
+            if (hi > maxV[c])
+            {
+               maxV[c] = hi;
+               minFirst[c] = yes;
+            }
+         }
+      }
+
+      column = x;
+   }
+}
+
 //***************************************************************************
 // Paint Event
 //***************************************************************************
@@ -329,72 +546,55 @@ void RenderArea::paintEvent(QPaintEvent* )
    yHeight = height() - 30 -5;
    yScale = (int)(((double)yHeight)/100.0);   // alle 5% ein step
 
-   painter = new QPainter(this);
+   QPainter p(this);
+   painter = &p;
 
    // 
 
    paintXAxis();
    paintYAxis();
 
-   // draw graph
+   // zoomed, scrolled or resized, build the geometry again
 
-   int iOff = (int)(xStart * 1000.0 / gcScale);
+   if (size() != geometrySize || xScale != geometryScale || xStart != geometryStart)
+   {
+      geometrySize = size();
+      geometryScale = xScale;
+      geometryStart = xStart;
 
-   // 
+      for (int l = 0; l < lines.size(); l++)
+         lines[l].valid = no;
+   }
+
+   // draw graph
 
    for (int l = 0; l < lines.size(); l++)
    {
+      Line* line = &lines[l];
       QPen pen = painter->pen();
-      int yVNow = yNull;
-      int yANow = yNull;
-      int yPNow = yNull;
-      int xDiff = (int)((double)xScale * (gcScale / 100.0));
-      int xNow = xNull;
-
-      pen.setColor(lines.at(l).color);
-
-      if (lines.at(l).volts.size() > iOff)
-      {
-         for (int i = iOff; i < lines.at(l).volts.size(); i++) 
-         {
-            int yVLast = yVNow;
-            int yALast = yANow;
-            int yPLast = yPNow;
-
-            double p = lines.at(l).volts.at(i) * lines.at(l).amperes.at(i);
-
-            int vp = (int)((double)lines.at(l).volts.at(i) / 255.0 * 100.0);
-            int ap = (int)((double)lines.at(l).amperes.at(i) / 255.0 * 100.0);
-            int pp = (int)(p / 255.0 * 100.0) / 150;  // 150 -> scale to fit window
-
-            yVNow = yNull-(vp * yScale);
-            yANow = yNull-(ap * yScale);
-            yPNow = yNull-(pp * yScale);
 
-            if (showVolt)
-            {
-               pen.setStyle(Qt::DashLine);
-               painter->setPen(pen);
-               painter->drawLine(xNow, yVLast, xNow+xDiff, yVNow);
-            }
-            if (showAmpere)
-            {
-               pen.setStyle(Qt::DotLine);
-               painter->setPen(pen);
-               painter->drawLine(xNow, yALast, xNow+xDiff, yANow);
-            }
-            if (showPower)
-            {            
-               pen.setStyle(Qt::SolidLine);
-               painter->setPen(pen);
-               painter->drawLine(xNow, yPLast, xNow+xDiff, yPNow);
-            }
+      if (!line->valid)
+         buildGeometry(line);
 
-            xNow += xDiff;
+      pen.setColor(line->color);
 
-            if (i > xWidth)
-               break;
-         }
+      if (showVolt)
+      {
+         pen.setStyle(Qt::DashLine);
+         painter->setPen(pen);
+         painter->drawPolyline(line->polygons[cvVolt]);
+      }
+      if (showAmpere)
+      {
+         pen.setStyle(Qt::DotLine);
+         painter->setPen(pen);
+         painter->drawPolyline(line->polygons[cvAmpere]);
+      }
+      if (showPower)
+      {
+         pen.setStyle(Qt::SolidLine);
+         painter->setPen(pen);
+         painter->drawPolyline(line->polygons[cvPower]);
       }
    }
 
@@ -403,6 +603,5 @@ void RenderArea::paintEvent(QPaintEvent* )
    painter->setPen(palette().dark().color());
    painter->setBrush(Qt::NoBrush);
    painter->drawRect(QRect(0, 0, width() - 1, height() - 1));
-
-   delete painter;
+   painter = 0;
 }
@@ -14,12 +14,21 @@
 #include <QPen>
 #include <QPainter>
 #include <QModelIndex>
-#include <QSqlTableModel>
+#include <QStandardItemModel>
 #include <QPushButton>
 #include <QTableView>
+#include <QPolygon>
+#include <QVector>
+
+#include <dbservice.hpp>
 
 //***************************************************************************
 // class RenderArea
+//  - the polylines are built once for the current zoom, scroll position
+//    and size, a paint only draws them
+//  - a profile with more samples than pixels is reduced to the min and
+//    max of each pixel column, read from the level of the min/max pyramid
+//    whose buckets are just below a pixel, a paint costs O(visible pixels)
 //***************************************************************************
 
 class RenderArea : public QWidget
@@ -28,18 +37,45 @@ class RenderArea : public QWidget
 
    public:
 
+      enum Curve
+      {
+         cvVolt,
+         cvAmpere,
+         cvPower,
+
+         cvCount
+      };
+
+      struct Level
+      {
+         QVector<int> min[cvCount];        // of 2^level samples, levels[0] is level 1
+         QVector<int> max[cvCount];
+      };
+
       struct Line
       {
          QString name;
          QColor color;
-         QList<int> volts;
-         QList<int> amperes;
+         int scale;                // ms per value
+         QVector<int> values[cvCount];     // [%] of the full range
+         QList<Level> levels;              // min/max pyramid of the values
+         QPolygon polygons[cvCount];       // geometry, valid if 'valid' is set
+         int valid;
+      };
+
+      enum Column
+      {
+         colId,
+         colName,
+         colCourse,
+         colLength
       };
 
       RenderArea(QWidget *parent = 0);
 
-      void setTableView(QTableView* v) { tableView = v, model = (QSqlTableModel*)tableView->model(); }
-      void setGcScale(int scale)       { gcScale = scale; }
+      void setDbService(DbService* s)  { dbService = s; }
+      void setTableView(QTableView* v) { tableView = v, model = (QStandardItemModel*)tableView->model(); }
+      int reload();
 
    public slots:
 
@@ -55,11 +91,19 @@ class RenderArea : public QWidget
       void checkPower(int state);
       void doubleClicked(const QModelIndex& index);
 
+   protected slots:
+
+      void onProfilesLoaded(DbJob* job);
+      void onEditLoaded(DbJob* job);
+      void onLineLoaded(DbJob* job);
+
    protected:
 
       void paintEvent(QPaintEvent *event);
       void paintXAxis();
       void paintYAxis();
+      void buildLevels(Line* line);
+      void buildGeometry(Line* line);
 
       // data
 
@@ -76,9 +120,12 @@ class RenderArea : public QWidget
       QList<Line> lines;
       int xScale;
       int xStart;
-      QSqlTableModel* model;
+      QSize geometrySize;       // widget size, zoom and scroll position
+      int geometryScale;        //   the geometry of the lines was built for
+      int geometryStart;
+      QStandardItemModel* model;
       QTableView* tableView;
-      double gcScale;
+      DbService* dbService;
 
       // edit dialog stuff
 
@@ -0,0 +1,371 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File laptelemetry.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <algorithm>
+
+#include <laptelemetry.hpp>
+
+//***************************************************************************
+// Class Telemetry Codec
+//***************************************************************************
+//***************************************************************************
+// Encode
+//***************************************************************************
+
+QByteArray TelemetryCodec::encode(const QByteArray& samples)
+{
+   QByteArray data;
+   int count = samples.size();
+   int i = 1;
+
+   if (!count)
+      return data;
+
+   byte last = samples.at(0);
+   data.append((char)last);
+
+   while (i < count)
+   {
+      byte value = samples.at(i);
+
+      if (value == last)
+      {
+         int run = 1;
+
+         while (i+run < count && run < 256 && (byte)samples.at(i+run) == last)
+            run++;
+
+         data.append((char)0);
+         data.append((char)(run-1));
+         i += run;
+
+         continue;
+      }
+
+      int delta = value - last;
+
+      if (delta >= -127 && delta <= 127)
+         data.append((char)((delta << 1) ^ (delta >> 31)));
+      else
+      {
+         data.append((char)0xFF);
+         data.append((char)value);
+      }
+
+      last = value;
+      i++;
+   }
+
+   return data;
+}
+
+//***************************************************************************
+// Decode
+//***************************************************************************
+
+int TelemetryCodec::decode(const QByteArray& data, int count, QByteArray& samples)
+{
+   int i = 1;
+
+   samples.clear();
+
+   if (!count)
+      return success;
+
+   if (data.isEmpty())
+      return fail;
+
+   samples.reserve(count);
+
+   byte last = data.at(0);
+   samples.append((char)last);
+
+   while (i < data.size() && samples.size() < count)
+   {
+      byte token = data.at(i++);
+
+      if (token == 0 || token == 0xFF)
+      {
+         if (i >= data.size())
+            return fail;
+
+         byte arg = data.at(i++);
+
+         if (token == 0)
+         {
+            samples.append(QByteArray(arg+1, last));
+            continue;
+         }
+
+         last = arg;
+      }
+      else
+      {
+         last += (token >> 1) ^ -(token & 1);
+      }
+
+      samples.append((char)last);
+   }
+
+   return samples.size() == count && i == data.size() ? success : fail;
+}
+
+//***************************************************************************
+// Class Telemetry Recorder
+//***************************************************************************
+//***************************************************************************
+// Start / Reset
+//***************************************************************************
+
+void TelemetryRecorder::start(int aCycle)
+{
+   cycle = aCycle;
+   reset();
+}
+
+void TelemetryRecorder::reset()
+{
+   started = no;
+   volts.clear();
+   amperes.clear();
+   cuts.clear();
+}
+
+//***************************************************************************
+// Index Of
+//  - sample position of a point in time, relative to the origin
+//***************************************************************************
+
+int TelemetryRecorder::indexOf(const timeval* tp)
+{
+   long long usec = SlotService::elapsed(&origin, tp);
+   long long period = cycle * 1000LL;
+
+   if (usec < 0)
+      return -(int)((-usec + period/2) / period);
+
+   return (usec + period/2) / period;
+}
+
+//***************************************************************************
+// Add
+//  - samples before the first passing of the start line are dropped
+//***************************************************************************
+
+void TelemetryRecorder::add(const SlotService::TelemetryEvent& event, QList<Lap>& done)
+{
+   if (!cycle || !started)
+      return ;
+
+   int index = indexOf(&event.tp);
+
+   for (int i = 0; i < event.count; i++, index++)
+   {
+      if (index < volts.size())        // before the start line or overlapping
+         continue;
+
+      if (index >= maxSamples)
+         break;
+
+      // gap -> repeat the last sample
+
+      while (volts.size() < index)
+      {
+         volts.append(volts.isEmpty() ? event.volt[i] : volts.at(volts.size()-1));
+         amperes.append(amperes.isEmpty() ? event.ampere[i] : amperes.at(amperes.size()-1));
+      }
+
+      volts.append(event.volt[i]);
+      amperes.append(event.ampere[i]);
+   }
+
+   complete(done, no);
+}
+
+//***************************************************************************
+// Cut Lap
+//  - lap 0 is the first passing of the start line, the origin of lap 1
+//***************************************************************************
+
+void TelemetryRecorder::cutLap(int lap, const timeval* tp)
+{
+   if (!cycle)
+      return ;
+
+   if (!lap || !started)
+   {
+      reset();
+      started = yes;
+      origin = *tp;
+
+      return ;
+   }
+
+   Cut cut;
+
+   cut.lap = lap;
+   cut.index = qMin(indexOf(tp), (int)maxSamples);
+
+   if (cut.index > 0)
+      cuts.append(cut);
+}
+
+//***************************************************************************
+// Stop
+//  - the laps still waiting for samples are completed with the last one
+//***************************************************************************
+
+void TelemetryRecorder::stop(QList<Lap>& done)
+{
+   complete(done, yes);
+
+   cycle = 0;
+   reset();
+}
+
+//***************************************************************************
+// Complete
+//***************************************************************************
+
+void TelemetryRecorder::complete(QList<Lap>& done, int force)
+{
+   while (!cuts.isEmpty() && (force || volts.size() >= cuts.first().index))
+   {
+      Cut cut = cuts.takeFirst();
+      Lap lap;
+
+      if (volts.isEmpty())
+         continue;
+
+      while (volts.size() < cut.index)
+      {
+         volts.append(volts.at(volts.size()-1));
+         amperes.append(amperes.at(amperes.size()-1));
+      }
+
+      lap.lap = cut.lap;
+      lap.start = origin;
+      lap.volts = volts.left(cut.index);
+      lap.amperes = amperes.left(cut.index);
+      done.append(lap);
+
+      volts.remove(0, cut.index);
+      amperes.remove(0, cut.index);
+      origin = SlotService::addMs2Tv(origin, cut.index * cycle);
+
+      for (int i = 0; i < cuts.size(); i++)
+         cuts[i].index -= cut.index;
+   }
+}
+
+//***************************************************************************
+// Class Telemetry Query
+//***************************************************************************
+//***************************************************************************
+// Execute
+//***************************************************************************
+
+static bool bySlotAndLap(const TelemetryQuery::Trace& a, const TelemetryQuery::Trace& b)
+{
+   return a.slot < b.slot || (a.slot == b.slot && a.lap < b.lap);
+}
+
+int TelemetryQuery::execute(SqliteDb* db)
+{
+   TsReader none;
+   TsReader* store = reader ? reader : &none;
+
+   // blocks appended since the last query
+
+   if (reader)
+      reader->refresh();
+
+   if (raceId == na)
+   {
+      SqliteDb::Cursor cursor(db, "SELECT max(RACE_ID) FROM lap_telemetry;");
+
+      if (cursor.next() && !cursor.isNull(0))
+         raceId = cursor.getInt(0);
+
+      raceId = qMax(raceId, store->lastRace());
+
+      if (raceId == na)
+         return success;
+   }
+
+   SqliteDb::Cursor cursor(db,
+      "SELECT LAP_ID, SLOT, LAP_NR, CYCLE, COUNT, VOLTS, AMPERES "
+      "FROM lap_telemetry WHERE RACE_ID = ?1 "
+      "AND (?2 IS NULL OR SLOT = ?2) AND (?3 IS NULL OR LAP_NR = ?3) "
+      "ORDER BY SLOT, LAP_NR;");
+
+   if (!cursor.isValid())
+      return fail;
+
+   db->bindInt(cursor.getStatement(), 1, raceId);
+   slot == na ? db->bindNull(cursor.getStatement(), 2) : db->bindInt(cursor.getStatement(), 2, slot);
+   lap == na ? db->bindNull(cursor.getStatement(), 3) : db->bindInt(cursor.getStatement(), 3, lap);
+
+   while (cursor.next())
+   {
+      Trace trace;
+      int count = cursor.getInt(4);
+      QByteArray volts((const char*)cursor.getBlob(5), cursor.getBlobSize(5));
+      QByteArray amperes((const char*)cursor.getBlob(6), cursor.getBlobSize(6));
+
+      trace.lapId = cursor.getInt64(0);
+      trace.slot = cursor.getInt(1);
+      trace.lap = cursor.getInt(2);
+      trace.cycle = cursor.getInt(3);
+
+      if (TelemetryCodec::decode(volts, count, trace.volts) != success
+          || TelemetryCodec::decode(amperes, count, trace.amperes) != success)
+      {
+         tell(eloAlways, "Warning: Telemetry of lap (%lld) is corrupt, skipping", trace.lapId);
+         continue;
+      }
+
+      traces.append(trace);
+   }
+
+   // the laps written to the store
+
+   QList<int> found;
+
+   store->find(raceId, slot, lap, found);
+
+   for (int i = 0; i < found.size(); i++)
+   {
+      TsStore::Series series;
+      Trace trace;
+
+      if (store->read(found.at(i), &series) != success || series.channels < 2)
+         continue;
+
+      trace.lapId = na;
+      trace.slot = series.slot;
+      trace.lap = series.lap;
+      trace.cycle = series.times.size() > 1 ? (series.times.at(1) - series.times.at(0)) / 1000 : 0;
+
+      for (int s = 0; s < series.times.size(); s++)
+      {
+         trace.volts.append((char)series.values[0].at(s));
+         trace.amperes.append((char)series.values[1].at(s));
+      }
+
+      traces.append(trace);
+   }
+
+   std::sort(traces.begin(), traces.end(), bySlotAndLap);
+
+   return success;
+}
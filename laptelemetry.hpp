@@ -0,0 +1,133 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File laptelemetry.hpp
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+#ifndef _LAPTELEMETRY_H_
+#define _LAPTELEMETRY_H_
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <QByteArray>
+#include <QList>
+
+#include <common.hpp>
+#include <dbservice.hpp>
+#include <tsstore.hpp>
+
+//***************************************************************************
+// Class Telemetry Codec
+//  - one channel (volt or ampere) of a lap, 8 bit samples
+//  - the first sample is stored as is, then per sample:
+//      0x00 n    -> n+1 samples unchanged
+//      0x01-0xFE -> zigzag coded delta (-127..127)
+//      0xFF v    -> absolute value v (larger step)
+//  - a car at constant throttle or standing costs 2 byte per 256 samples
+//***************************************************************************
+
+class TelemetryCodec
+{
+   public:
+
+      static QByteArray encode(const QByteArray& samples);
+      static int decode(const QByteArray& data, int count, QByteArray& samples);
+};
+
+//***************************************************************************
+// Class Telemetry Recorder
+//  - collects the sample blocks of one slot and cuts them into laps
+//  - the blocks arrive up to a half second late, a lap is complete if
+//    the samples up to its signal are received (or by stop())
+//  - samples are placed by their time, gaps repeat the last sample
+//***************************************************************************
+
+class TelemetryRecorder
+{
+   public:
+
+      enum Misc
+      {
+         maxSamples = 30000            // buffer limit, 10 minutes at 20ms
+      };
+
+      struct Lap
+      {
+         int lap;
+         timeval start;                // time of the first sample
+         QByteArray volts;
+         QByteArray amperes;
+      };
+
+      TelemetryRecorder()              { cycle = 0; reset(); }
+
+      void start(int aCycle);
+      void reset();
+      int isActive()                   { return cycle > 0; }
+      int getCycle()                   { return cycle; }
+
+      void add(const SlotService::TelemetryEvent& event, QList<Lap>& done);
+      void cutLap(int lap, const timeval* tp);
+      void stop(QList<Lap>& done);
+
+   protected:
+
+      struct Cut
+      {
+         int lap;
+         int index;                    // first sample of the next lap
+      };
+
+      int indexOf(const timeval* tp);
+      void complete(QList<Lap>& done, int force);
+
+      int cycle;                       // [ms]
+      int started;                     // start line passed, origin is valid
+      timeval origin;                  // time of the first sample in the buffer
+      QByteArray volts;
+      QByteArray amperes;
+      QList<Cut> cuts;
+};
+
+//***************************************************************************
+// Class Telemetry Query
+//  - loads the traces of a race (latest race with telemetry if raceId is na),
+//    of one slot and lap or all of them
+//  - from the table lap_telemetry and the store's reader if given, it's
+//    owned by the DbService and only used by its thread
+//    (blocks still queued by the store's writer are not seen yet)
+//***************************************************************************
+
+class TelemetryQuery : public DbJob
+{
+   public:
+
+      struct Trace
+      {
+         long long lapId;              // na if from the store
+         int slot;
+         int lap;
+         int cycle;                    // [ms]
+         QByteArray volts;
+         QByteArray amperes;
+      };
+
+      TelemetryQuery(int aRaceId = na, int aSlot = na, int aLap = na, TsReader* aReader = 0)
+         : DbJob()                     { raceId = aRaceId; slot = aSlot; lap = aLap;
+                                         reader = aReader; }
+
+      int execute(SqliteDb* db);
+
+      TsReader* reader;                // DbService::getStoreReader()
+      int raceId;
+      int slot;
+      int lap;
+      QList<Trace> traces;
+};
+
+//***************************************************************************
+#endif // _LAPTELEMETRY_H_
@@ -23,14 +23,18 @@
 #include <QGraphicsView>
 #include <QDialog>
 #include <QInputDialog>
-#include <QSqlQuery>
-#include <QSqlTableModel>
+#include <QStandardItemModel>
 #include <QSplitter>
 #include <QHeaderView>
 #include <QToolButton>
+#include <QVBoxLayout>
 
 #include <linslot.hpp>
 #include <lapprofile.hpp>
+#include <logger.hpp>
+#include <trace.hpp>
+#include <journal.hpp>
+#include <schema.hpp>
 
 #include <version.hpp>
 
@@ -48,15 +52,22 @@ LinslotWindow::LinslotWindow()
    logFile = "";
    withSound = no;
    raceRunning = no;
+   telemetryStopPending = no;
+   finishPending = no;
    countdownStarted = no;
    countdown = 0;
    fastLapTime = 0;
+   trackRecord = 0;
    resourcePath = 0;
    configPath = QString(QDir::homePath() + "/.linslot");
    gcState = gcsOff;
    gcSlot = na;
    visibleImage = imgDriver;
    supressComboBoxUpdate = no;
+   dbService = 0;
+   imageService = 0;
+   telemetryDialog = 0;
+   telemetry = 0;
 
    QDir d(configPath);
 
@@ -76,6 +87,12 @@ LinslotWindow::LinslotWindow()
    connect(setupDialog, SIGNAL(accepted()),
            this, SLOT(onOptionsAccepted()));
 
+   // images are decoded in the background
+
+   imageService = new ImageService();
+   connect(imageService, SIGNAL(imageReady()), this, SLOT(onImageReady()));
+   imageService->open();
+
    // init
 
    init();
@@ -98,6 +115,10 @@ LinslotWindow::LinslotWindow()
    timerAnimateImage = new QTimer(this);
    connect(timerAnimateImage, SIGNAL(timeout()), this, SLOT(onAnimateTimer()));
 
+   timerGcStop = new QTimer(this);
+   timerGcStop->setSingleShot(true);
+   connect(timerGcStop, SIGNAL(timeout()), this, SLOT(onGhostCarStopTimeout()));
+
    // thread stuff
 
    thread = new IoThread();
@@ -106,6 +127,7 @@ LinslotWindow::LinslotWindow()
 
    qRegisterMetaType<DigitalEvent>("DigitalEvent");
    qRegisterMetaType<AnalogEvent>("AnalogEvent");
+   qRegisterMetaType<TelemetryEvent>("TelemetryEvent");
 
    connect(thread, SIGNAL(onDigitalInput(const DigitalEvent)),
            this, SLOT(onDigitalInput(const DigitalEvent)));
@@ -113,6 +135,12 @@ LinslotWindow::LinslotWindow()
    connect(thread, SIGNAL(onAnalogInput(const AnalogEvent)),
            this, SLOT(onAnalogInput(const AnalogEvent)));
 
+   connect(thread, SIGNAL(onTelemetry(const TelemetryEvent)),
+           this, SLOT(onTelemetry(const TelemetryEvent)));
+
+   connect(thread, SIGNAL(onGhostCarRecorded()),
+           this, SLOT(onGhostCarRecorded()));
+
    connect(thread, SIGNAL(onDeviceConnected(const int)),
            this, SLOT(onDeviceConnected(const int)));
 
@@ -136,7 +164,8 @@ LinslotWindow::~LinslotWindow()
 
    delete highscoreDialog;
    delete setupDialog;
-   delete db;
+   delete dbService;
+   delete imageService;
    delete thread;
 
    delete timer;
@@ -146,6 +175,10 @@ LinslotWindow::~LinslotWindow()
 
    if (resourcePath)
       free(resourcePath);
+
+   Logger::stopWriter();
+   Trace::close();
+   Journal::close();
 }
 
 //***************************************************************************
@@ -155,12 +188,14 @@ LinslotWindow::~LinslotWindow()
 void LinslotWindow::init()
 {
    int trySound = yes;
+   int rebuild = no;
+   QString journalDir = configPath + "/journal";
 
    resourcePath = strdup(setupDialog->getResourcePath());
 
    // widged stuff
 
-   ledsParent = labelLed00->parent();           // !!
+   initLeds();
 
    // output states
 
@@ -187,6 +222,9 @@ void LinslotWindow::init()
             printf("       -s         no sound\n");
             printf("       -f <file>  log to file\n");
             printf("       -e <n>     eloquence (log level)\n");
+            printf("       -T <file>  binary trace to file (read it with tracedump)\n");
+            printf("       -J <dir>   event journal directory or 'off' (read it with journaldump)\n");
+            printf("       -R         rebuild the records from the laps\n");
             printf("       -t         test mode\n");
 
             ::exit(0);
@@ -214,9 +252,39 @@ void LinslotWindow::init()
             trySound = no;
             break;
          }
+         case 'R':
+         {
+            rebuild = yes;
+            break;
+         }
+         case 'T':
+         {
+            i++;
+
+            if (Trace::open(QCoreApplication::arguments().at(i).toAscii().constData()) != success)
+               tell(eloAlways, "Opening trace file '%s' failed",
+                    QCoreApplication::arguments().at(i).toAscii().constData());
+
+            break;
+         }
+         case 'J':
+         {
+            i++;
+            journalDir = QCoreApplication::arguments().at(i);
+            break;
+         }
       }
    }
 
+   // journal of all i/o events, a new one each session
+
+   if (journalDir != "off" && Journal::open(journalDir.toAscii().constData()) != success)
+      tell(eloAlways, "Opening journal in '%s' failed", journalDir.toAscii().constData());
+
+   // from now on log messages are written by the writer thread
+
+   Logger::startWriter(logFile);
+
    // init slot data
 
    for (int i = 0; i < slotCount; i++)
@@ -227,6 +295,7 @@ void LinslotWindow::init()
       *theSlots[i].car = 0;
       theSlots[i].fueling = no;
       theSlots[i].gcProfile = na;
+      theSlots[i].personalBest = 0;
 
       theSlots[i].progressBarFuel = i == 0 ?  progressBarFuelSlot1 : progressBarFuelSlot2;
       theSlots[i].labelLapCount = i == 0 ?  labelLapCounter1 : labelLapCounter2;
@@ -256,6 +325,8 @@ void LinslotWindow::init()
 
    if (openDb() != success)
       pushButtonHallOfFame->setEnabled(no);
+   else if (rebuild)
+      dbService->rebuildRecords();
 
    tell(eloDebug, "open db done");
 
@@ -273,7 +344,11 @@ void LinslotWindow::exit()
 {
    tell(eloDebug, "Exit!");
 
-   if (db) db->close();
+   if (telemetryStopPending)
+      flushTelemetry();
+
+   if (dbService) dbService->close();
+   if (imageService) imageService->close();
 
    storeConfig();
 
@@ -286,6 +361,10 @@ void LinslotWindow::exit()
       tell(eloAlways, "Thread would not end!");
    else
       tell(eloAlways, "Thread ended regularly");
+
+#ifndef Q_OS_WIN32
+   QAlsaPlayer::stop();
+#endif
 }
 
 //***************************************************************************
@@ -414,7 +493,6 @@ void LinslotWindow::resetWidgets()
    updateDriverImage(labelImageSlot1->width(), labelImageSlot1->height());
    pushButtonStartRace->setEnabled(thread->isOpen() || testMode);
    pushButtonPower->setEnabled(thread->isOpen() || testMode);
-   pushButtonSaveToDb->setEnabled(no);
    toolButtonRecordGhostCar->setEnabled(no);
 }
 
@@ -457,33 +535,103 @@ int LinslotWindow::getImagesFor(int led, const char* &ledOn, const char* &ledOff
    return success;
 }
 
+//***************************************************************************
+// Index Of Led
+//  - the led ids are bits, ledGreen (1) is index 1
+//***************************************************************************
+
+int LinslotWindow::indexOfLed(int led)
+{
+   int index = 1;
+
+   if (led <= 0)
+      return na;
+
+   while (!(led & 1))
+   {
+      led >>= 1;
+      index++;
+   }
+
+   return index < ledCount ? index : na;
+}
+
+//***************************************************************************
+// Init Leds
+//  - the images are loaded and the labels looked up once, setLed()
+//    is called for each flashing output on every tick of timerFlash
+//***************************************************************************
+
+void LinslotWindow::initLeds()
+{
+   QObject* parent = labelLed00->parent();           // !!
+
+   for (int i = 0; i < ledCount; i++)
+   {
+      ledViews[i].labels.clear();
+      ledViews[i].state = na;
+   }
+
+   for (int i = 0; i < parent->children().size(); i++)
+   {
+      QLabel* label = qobject_cast<QLabel*>(parent->children().at(i));
+      int index;
+
+      if (label && (index = indexOfLed(label->indent())) != na)
+         ledViews[index].labels.append(label);
+   }
+
+   loadLedImages();
+}
+
+//***************************************************************************
+// Load Led Images
+//  - from the resource path, the labels of leds already set are repainted
+//***************************************************************************
+
+void LinslotWindow::loadLedImages()
+{
+   for (int i = 1; i < ledCount; i++)
+   {
+      const char* ledOn  = "";
+      const char* ledOff = "";
+
+      if (getImagesFor(1 << (i-1), ledOn, ledOff) != success)
+         continue;
+
+      ledViews[i].on = QPixmap(QString(resourcePath) + ledOn);
+      ledViews[i].off = QPixmap(QString(resourcePath) + ledOff);
+
+      if (ledViews[i].state == na)
+         continue;
+
+      for (int l = 0; l < ledViews[i].labels.size(); l++)
+         ledViews[i].labels.at(l)->setPixmap(ledViews[i].state ? ledViews[i].on : ledViews[i].off);
+   }
+}
+
 //***************************************************************************
 // Set Led
 //***************************************************************************
 
 void LinslotWindow::setLed(int function, int state)
 {
-   const char* ledOn  = "";
-   const char* ledOff = "";
+   int index = indexOfLed(outputBits[function].ledid);
 
-   if (outputBits[function].ledid <= 0)
+   if (index == na)
       return ;
 
-   if (getImagesFor(outputBits[function].ledid, ledOn, ledOff) != success)
+   LedView* led = &ledViews[index];
+
+   state = state ? yes : no;
+
+   if (led->state == state)
       return ;
 
-   for (int i = 0; i < ledsParent->children().size(); i++)
-   {
-      QLabel* label = qobject_cast<QLabel*>(ledsParent->children().at(i));
+   led->state = state;
 
-      if (label && label->indent() == outputBits[function].ledid)
-      {
-         if (state)
-            label->setPixmap(QPixmap(QString(resourcePath) + ledOn));
-         else
-            label->setPixmap(QPixmap(QString(resourcePath) + ledOff));
-      }
-   }
+   for (int i = 0; i < led->labels.size(); i++)
+      led->labels.at(i)->setPixmap(state ? led->on : led->off);
 }
 
 //***************************************************************************
@@ -638,7 +786,7 @@ void LinslotWindow::setSlotPower(int slot, int flag)
 void LinslotWindow::playSound(int fct)
 {
    if (sounds[fct].sound != "na")
-      ::playSound(QString(resourcePath) + "/sound/" + sounds[fct].sound);
+      ::playSound(QString(resourcePath) + "/sound/" + sounds[fct].sound, sounds[fct].priority);
 }
 
 //***************************************************************************
@@ -663,8 +811,12 @@ void LinslotWindow::applyOptions()
 {
    QListWidgetItem* listItem;
 
-   free(resourcePath);
-   resourcePath = strdup(setupDialog->getResourcePath());
+   if (qstrcmp(resourcePath, setupDialog->getResourcePath()) != 0)
+   {
+      free(resourcePath);
+      resourcePath = strdup(setupDialog->getResourcePath());
+      loadLedImages();
+   }
 
 #ifndef Q_OS_WIN32
 
@@ -672,11 +824,23 @@ void LinslotWindow::applyOptions()
    {
       QString oldDevice = QAlsaSound::getDeviceName();
 
+      QAlsaPlayer::stop();
       QAlsaSound::setDeviceName(setupDialog->getAlsaDevice());
 
-      if (!QAlsaSound::isAvailable())
+      if (QAlsaPlayer::start() != success)
+      {
          QAlsaSound::setDeviceName(oldDevice);
+         QAlsaPlayer::start();
+      }
+   }
+
+   // decode the configured sounds now, not at the first play
 
+   if (withSound)
+   {
+      for (int i = 0; i < sfCount; i++)
+         if (sounds[i].sound != "na")
+            QAlsaPlayer::preload(QString(resourcePath) + "/sound/" + sounds[i].sound);
    }
 
 #endif
@@ -740,6 +904,11 @@ void LinslotWindow::applyOptions()
    strncpy(theSlots[1].driver, theSlots[1].getDriver().toAscii(), sizeName);
    strncpy(theSlots[0].car, theSlots[0].getCar().toAscii(), sizeName);
    strncpy(theSlots[1].car, theSlots[1].getCar().toAscii(), sizeName);
+   loadGcProfile();
+
+   // the bits may have changed
+
+   thread->setJournalLanes();
 
    // Image animation mode
 
@@ -767,6 +936,7 @@ void LinslotWindow::on_comboBoxDriver1_currentIndexChanged(QString value)
    if (!supressComboBoxUpdate)
    {
       strncpy(theSlots[0].driver, value.toAscii(), sizeName);
+      loadGcProfile();
 
       updateDriverImage(labelImageSlot1->width(),
                         labelImageSlot1->height());
@@ -968,15 +1138,122 @@ void LinslotWindow::onAnalogInput(const AnalogEvent ioEvent)
    int u = (int)((double)volt / 255.0 * 100.0);
    int i = (int)((double)ioEvent.ampere / 255.0 * 100.0);
 
-   if (gcState == gcsRecording)
+   if (telemetry)
+   {
+      telemetry->append(seriesVolt, u);
+      telemetry->append(seriesAmpere, i);
+   }
+
+   if (gcState == gcsRecording || gcState == gcsStopping)
    {
       labelFastLap->setText(QString::number(u) + "%");
 
-      tell(eloAlways, "-> U = %d%%; I = %d%% [%d/%d]", u, i, volt, ioEvent.ampere);
+      TRACE(eloDebug, "-> U = %d%%; I = %d%% [%d/%d]", u, i, volt, ioEvent.ampere);
       gcValues.append(volt | (ioEvent.ampere << 8));
    }
 }
 
+//***************************************************************************
+// On Telemetry
+//  - a sample block of one slot while the race is running
+//***************************************************************************
+
+void LinslotWindow::onTelemetry(const TelemetryEvent ioEvent)
+{
+   QList<TelemetryRecorder::Lap> laps;
+
+   if (ioEvent.slot < 0 || ioEvent.slot >= slotCount)
+      return ;
+
+   recorders[ioEvent.slot].add(ioEvent, laps);
+   storeTelemetry(ioEvent.slot, recorders[ioEvent.slot].getCycle(), laps);
+}
+
+void LinslotWindow::onTelemetryStop()
+{
+   // a new race flushed the recorders meanwhile
+
+   if (!telemetryStopPending)
+      return ;
+
+   flushTelemetry();
+}
+
+//***************************************************************************
+// Flush Telemetry
+//  - stop the recorders and queue the rest, a finished race is queued
+//    behind its last laps, otherwise their telemetry would be ignored
+//***************************************************************************
+
+void LinslotWindow::flushTelemetry()
+{
+   telemetryStopPending = no;
+   thread->recordTelemetry(0, 0, 0);
+
+   for (int i = 0; i < slotCount; i++)
+   {
+      QList<TelemetryRecorder::Lap> laps;
+      int cycle = recorders[i].getCycle();
+
+      recorders[i].stop(laps);
+      storeTelemetry(i, cycle, laps);
+   }
+
+   if (finishPending)
+   {
+      finishPending = no;
+
+      if (dbService)
+         dbService->raceFinished();
+   }
+}
+
+void LinslotWindow::storeTelemetry(int slot, int cycle, const QList<TelemetryRecorder::Lap>& laps)
+{
+   if (!dbService)
+      return ;
+
+   for (int i = 0; i < laps.size(); i++)
+      dbService->telemetryDone(slot, laps.at(i).lap,
+                               laps.at(i).start.tv_sec * 1000000LL + laps.at(i).start.tv_usec, cycle,
+                               laps.at(i).volts, laps.at(i).amperes);
+}
+
+//***************************************************************************
+// On Ghost Car Recorded
+//  - the board sent the last block of the recording
+//***************************************************************************
+
+void LinslotWindow::onGhostCarRecorded()
+{
+   if (gcState != gcsStopping)
+      return ;
+
+   timerGcStop->stop();
+   tell(eloAlways, "GC recording finished, got (%d) values", gcValues.size());
+   gcState = gcsOff;
+   gcSlot = na;
+   storeGcRecording(&gcValues);
+   labelInfo->setText("Standby");
+   labelFastLap->setText("");
+}
+
+//***************************************************************************
+// On Ghost Car Stop Timeout
+//  - the last block of the board got lost, store what we received
+//***************************************************************************
+
+void LinslotWindow::onGhostCarStopTimeout()
+{
+   if (gcState != gcsStopping)
+      return ;
+
+   tell(eloAlways, "GC last block missing after %dms, storing the received values",
+        gcStopTimeout);
+
+   onGhostCarRecorded();
+}
+
 //***************************************************************************
 // On I/O Signal
 //***************************************************************************
@@ -989,8 +1266,7 @@ void LinslotWindow::onDigitalInput(const DigitalEvent ioEvent)
    if (!(value = getChanges(theEvent)))
       return ;
 
-   char buf[100+TB];
-   tell(eloDebug, "Debug: Changes detected (%s)", toBinStr(value, buf));
+   TRACE(eloDebug, "Debug: Changes detected (%32b)", value);
 
    // externer Start/Stop Taster (nicht im test mode) ?
 
@@ -1077,24 +1353,14 @@ void LinslotWindow::on_pushButtonOptions_clicked()
 
 void LinslotWindow::on_pushButtonHallOfFame_clicked()
 {
-   if (!db)
+   if (!dbService)
       return ;
 
-   highscoreDialog->setDb(db);
+   highscoreDialog->setDbService(dbService);
    highscoreDialog->fill();
    highscoreDialog->show();
 }
 
-//***************************************************************************
-// On Button Save To Db
-//***************************************************************************
-
-void LinslotWindow::on_pushButtonSaveToDb_clicked()
-{
-   saveRace();
-   pushButtonSaveToDb->setEnabled(no);
-}
-
 //***************************************************************************
 // At Start
 //***************************************************************************
@@ -1137,6 +1403,7 @@ void LinslotWindow::initRace()
       theSlots[i].penalty = 0;
       theSlots[i].lap = -1;
       theSlots[i].fastLapTime = 0;
+      theSlots[i].stats.reset();
       theSlots[i].fueling = no;
       theSlots[i].fuelLevel = setupDialog->getFuelMax();
    }
@@ -1162,6 +1429,11 @@ void LinslotWindow::initRace()
 
 void LinslotWindow::atStart()
 {
+   // the last race is still waiting for its telemetry, don't lose it
+
+   if (telemetryStopPending)
+      flushTelemetry();
+
    // init
 
    countdown = 0;
@@ -1170,14 +1442,13 @@ void LinslotWindow::atStart()
    gettimeofday(&raceStart, 0);
    timer->stop();
 
+   Journal::write(Journal::etRace, 0, 0, Journal::reStart);
+
    if (QString(theSlots[0].driver).indexOf("GC: ") == 0)
    {
-      QSqlQuery query("select PROFILE_ID from profiles where NAME = '"
-                      + QString(theSlots[0].driver[4]) + "';");
+      // loaded in the background when the driver was selected
 
-      if (query.next())
-         theSlots[0].gcProfile = query.value(0).toInt();
-      else
+      if (theSlots[0].gcProfile == na)
       {
          tell(eloAlways, "Fatal: Profile for '%s' not found", theSlots[0].driver);
          return ;
@@ -1188,7 +1459,7 @@ void LinslotWindow::atStart()
 
       thread->startGhostCar(outputBits[bitPwmOutSlot1].bit,
                             analogBits[fctGhostISlot1].bit,
-                            theSlots[0].gcProfile);
+                            gcReplayProfile);
 
       gcState = gcsRunning;
       gcSlot = 0;
@@ -1200,11 +1471,83 @@ void LinslotWindow::atStart()
    for (int i = 0; i < slotCount; i++)
       theSlots[i].lastSignal = raceStart;
 
+   // the laps are stored while the race is running
+
+   trackRecord = 0;
+
+   for (int i = 0; i < slotCount; i++)
+      theSlots[i].personalBest = 0;
+
+   if (telemetry)
+   {
+      int average = (int)(setupDialog->getAverageLap() * 1000.0);
+
+      telemetry->clear();
+
+      for (int i = 0; i < slotCount; i++)
+         telemetry->setRange(seriesLap[i], average / 2, average * 3 / 2);
+   }
+
+   // race telemetry, slot 1 and 2 are the lanes of the analog inputs 'slot 1' and 'slot 3'
+
+   if (setupDialog->getTelemetryActive())
+   {
+      char vBits[IoService::telemetryLanes];
+      char iBits[IoService::telemetryLanes];
+
+      vBits[0] = analogBits[fctGhostUSlot1].bit;
+      vBits[1] = analogBits[fctGhostUSlot3].bit;
+      iBits[0] = analogBits[fctGhostISlot1].bit;
+      iBits[1] = analogBits[fctGhostISlot3].bit;
+
+      for (int i = 0; i < slotCount; i++)
+         recorders[i].start(thread->getGcScale());
+
+      thread->recordTelemetry(thread->getGcScale(), vBits, iBits);
+   }
+
+   int stored = no;
+
+   if (dbService && *theSlots[0].driver && *theSlots[1].driver)
+   {
+      stored = yes;
+      dbService->raceStarted(theSlots[0].driver, theSlots[1].driver,
+                             theSlots[0].car, theSlots[1].car,
+                             radioButtonLapRace->isChecked()
+                             ? setupDialog->getLapCountRace() : setupDialog->getLapCountTraining(),
+                             setupDialog->getSlotLength(), setupDialog->getCourseName());
+
+      // records to compare the laps with
+
+      DbQuery* query = new DbQuery("SELECT "
+                                   "(SELECT min(BEST_LAP) FROM records WHERE COURSE = ?1 AND LAP_LENGTH = ?2), "
+                                   "(SELECT r.BEST_LAP FROM records AS r, drivers AS d "
+                                   "WHERE d.NAME = ?3 AND r.DRIVER_ID = d.DRIVER_ID AND r.CAR = ?4 "
+                                   "AND r.COURSE = ?1 AND r.LAP_LENGTH = ?2), "
+                                   "(SELECT r.BEST_LAP FROM records AS r, drivers AS d "
+                                   "WHERE d.NAME = ?5 AND r.DRIVER_ID = d.DRIVER_ID AND r.CAR = ?6 "
+                                   "AND r.COURSE = ?1 AND r.LAP_LENGTH = ?2);");
+
+      query->bind(setupDialog->getCourseName()).bind(setupDialog->getSlotLength())
+         .bind(theSlots[0].driver).bind(theSlots[0].car)
+         .bind(theSlots[1].driver).bind(theSlots[1].car);
+
+      dbService->submit(query, this, "onRecordsLoaded");
+   }
+
    if (radioButtonLapRace->isChecked())
       labelInfo->setText("Rennen luft");
    else
       labelInfo->setText("Freies Training");
 
+   // don't stop the start by a message box, the race runs anyway
+
+   if (dbService && !stored)
+   {
+      tell(eloAlways, "No driver selected, the race isn't stored");
+      labelInfo->setText(labelInfo->text() + "\nKein Fahrer gewhlt, wird nicht gespeichert!");
+   }
+
    playSound(sfRaceStart);
 }
 
@@ -1237,7 +1580,14 @@ void LinslotWindow::atFinish(int slot)
    for (int i = 0; i < slotCount; i++)
       tell(eloDebug, "Bahn %d - %d Runden gefahren", i+1, theSlots[i].lap);
 
-   pushButtonSaveToDb->setEnabled(yes);
+   Journal::write(Journal::etRace, 0, 0, Journal::reFinish);
+
+   // the telemetry of the last lap is still on the way
+
+   if (telemetryStopPending)
+      finishPending = yes;
+   else if (dbService)
+      dbService->raceFinished();
 }
 
 //***************************************************************************
@@ -1249,6 +1599,11 @@ void LinslotWindow::atAbort(const char* info)
    atStop(info);
    labelElapsed->setText("0.0");
 
+   Journal::write(Journal::etRace, 0, 0, Journal::reAbort);
+
+   if (dbService)
+      dbService->raceAborted();
+
    // playSound(sfRaceAborted);
 }
 
@@ -1279,6 +1634,14 @@ void LinslotWindow::atStop(const char* info)
       gcSlot = na;
    }
 
+   // the samples of the last lap are still on the way, stop a bit later
+
+   if (recorders[0].isActive() || recorders[1].isActive())
+   {
+      telemetryStopPending = yes;
+      QTimer::singleShot(1000, this, SLOT(onTelemetryStop()));
+   }
+
    // update widgets
 
    gettimeofday(&tp, 0);
@@ -1408,7 +1771,7 @@ unsigned int LinslotWindow::getChanges(DigitalEvent& ioEvent)
       {
          // bit changed -and- last change older than 'bounceTime'
 
-         tell(eloDebug2, "Bit %d toggled to %d", bit, state);
+         TRACE(eloDebug2, "Bit %d toggled to %d", bit, state);
 
          for (int fct = 0; fct < bitInputCount; fct++)
          {
@@ -1483,11 +1846,13 @@ void LinslotWindow::atFuelTimer(int slot)
 // At Fuel Signal
 //***************************************************************************
 
-void LinslotWindow::atFuelSignal(int slot, const timeval*, int fuelStartSignal)
+void LinslotWindow::atFuelSignal(int slot, const timeval* tp, int fuelStartSignal)
 {
    if (!raceRunning)
       return ;
 
+   Journal::write(Journal::etFuel, slot+1, thread->boardTimeOf(tp), fuelStartSignal);
+
    tell(eloDebug, "Got '%s' signal for slot %d",
         fuelStartSignal ? "start fueling" : "stop fueling", slot);
 
@@ -1521,18 +1886,28 @@ void LinslotWindow::decrementFuel(int slot, unsigned int usec)
    if (theSlots[slot].fuelLevel > 0)
    {
       double f = setupDialog->getFuelPerLap();
-      int uAverageLap = (int)(setupDialog->getAverageLap() * 1000000.0);
-      double diffPercent = labs(uAverageLap - usec) / (uAverageLap / 100.0);
+      const LapStatistics& stats = theSlots[slot].stats;
+      long long uAverageLap;
+
+      // the driver's own pace of the last laps, the setup value until there are some
+
+      if (stats.getCount() >= minPaceLaps)
+         uAverageLap = (long long)stats.getWindowMean();
+      else
+         uAverageLap = (long long)(setupDialog->getAverageLap() * 1000000.0);
+
+      long long diff = uAverageLap - (long long)usec;
+      double diffPercent = llabs(diff) / (uAverageLap / 100.0);
 
       diffPercent = qMin(diffPercent, 30.0);
 
-      tell(eloDebug3, "Debug: Diff to average lap %2d,%03d seconds => (%.2f%%), uAverageLap (%u), usec (%u)",
-           (uAverageLap-usec)/1000000L, labs((uAverageLap-usec))%1000000L,
-           diffPercent, uAverageLap, usec);
+      TRACE(eloDebug3, "Debug: Diff to average lap %2lld,%03lld seconds => (%.2f%%), uAverageLap (%lld), usec (%u)",
+            diff/1000000LL, llabs(diff)%1000000LL,
+            diffPercent, uAverageLap, usec);
 
       double korr = 0;
 
-      if (uAverageLap - usec > 0)
+      if (diff > 0)
          korr = 100 + diffPercent/10.0 * setupDialog->getFuelFactorFastLap();  // faster
       else
          korr = 100 - diffPercent/10.0 * setupDialog->getFuelFactorSlowLap();  // slower
@@ -1565,6 +1940,7 @@ void LinslotWindow::atSlotSignal(int slot, const timeval* tp)
    unsigned int usec = 0;
 
    tell(eloDebug, "Debug: Signal slot %d", slot);
+   Journal::write(Journal::etSignal, slot+1, thread->boardTimeOf(tp), 0);
 
    if (slot == 0 && !thread->readOutBit(outputBitOf(bitPowerSlot1)) && !testMode)
       return;
@@ -1576,14 +1952,14 @@ void LinslotWindow::atSlotSignal(int slot, const timeval* tp)
 
    if (gcState == gcsRecording && slot == gcSlot)
    {
-      tell(eloAlways, "GC recording finished, got (%d) values", gcValues.size());
-      gcState = gcsOff;
-      gcSlot = na;
+      // stop recording, the board flushes its last block
+      //  and confirms by an empty one -> onGhostCarRecorded()
+
+      tell(eloAlways, "GC recording stopped, waiting for last block");
+      gcState = gcsStopping;
+      timerGcStop->start(gcStopTimeout);
       thread->recordGhostCar(na, na);
       clearSlotPower();
-      storeGcRecording(&gcValues);
-      labelInfo->setText("Standby");
-      labelFastLap->setText("");
 
       return ;
    }
@@ -1599,7 +1975,7 @@ void LinslotWindow::atSlotSignal(int slot, const timeval* tp)
    }
    else if (gcState == gcsRunning && slot == gcSlot)
    {
-      thread->ghostCarSync();
+      thread->ghostCarSync(tp);
    }
 
    if (!countdownStarted && !raceRunning)
@@ -1666,6 +2042,10 @@ void LinslotWindow::atSlotSignal(int slot, const timeval* tp)
          labelSecondTime->setText("");
    }
 
+   // the lap is stored as soon as its samples are received
+
+   recorders[slot].cutLap(theSlots[slot].lap, tp);
+
    // erstes ueberfahren der Startlinie ?
 
    if (!theSlots[slot].lap)
@@ -1684,6 +2064,15 @@ void LinslotWindow::atSlotSignal(int slot, const timeval* tp)
    theSlots[slot].tableWidget->setRowCount(theSlots[slot].lap);
 
    QTableWidgetItem* itemTime = new QTableWidgetItem(QString::number(usec/1000000.0, 'f', 3));
+   itemTime->setData(Qt::UserRole, (qlonglong)usec);
+
+   Journal::write(Journal::etLap, slot+1, thread->boardTimeOf(tp), theSlots[slot].lap, usec);
+
+   if (dbService)
+      dbService->lapDone(slot, theSlots[slot].lap, usec);
+
+   showRecordDelta(slot, usec);
+
    QTableWidgetItem* itemKmh = new QTableWidgetItem(QString::number(kmh(setupDialog->getSlotLength(), usec)                                                                    * setupDialog->getSpeedFactor(), 'f', 2));
 
    // show lap overview
@@ -1709,11 +2098,17 @@ void LinslotWindow::atSlotSignal(int slot, const timeval* tp)
       theSlots[slot].fastLapTime = usec;
    }
 
-   // fueling
+   // fueling, compared with the laps before this one
 
    if (setupDialog->getFuelingActive())
       decrementFuel(slot, usec);
 
+   theSlots[slot].stats.add(usec);
+   showLapStatistics(slot);
+
+   if (telemetry)
+      telemetry->append(seriesLap[slot], usec / 1000);
+
    //
 
    if (radioButtonLapRace->isChecked())
@@ -1756,412 +2151,321 @@ void LinslotWindow::atSlotSignal(int slot, const timeval* tp)
 }
 
 //***************************************************************************
-// Update Driver Images
+// Records
+//  - loaded at the start of the race, afterwards kept up to date here
 //***************************************************************************
 
-void LinslotWindow::updateDriverImage(int width, int height)
+void LinslotWindow::onRecordsLoaded(DbJob* job)
 {
-   QString path;
+   DbQuery* query = (DbQuery*)job;
 
-   for (int i = 0; i < slotCount; i++)
-   {
-      if (visibleImage == imgDriver)
-         path = setupDialog->getDriverImage(theSlots[i].driver);
-      else
-         path = setupDialog->getCarImage(theSlots[i].car);
-
-      if (path.size() && QFile::exists(path))
-      {
-         QPixmap pixmap(path);
-
-         theSlots[i].labelImage->setPixmap(
-            pixmap.scaled(width, height, Qt::KeepAspectRatio));
-      }
-      else
-      {
-         theSlots[i].labelImage->clear();
-         theSlots[i].labelImage->setText(i == 1 ? ";)" : ":)");
-      }
-   }
-}
-
-//***************************************************************************
-// On Animation Timer
-//***************************************************************************
-
-void LinslotWindow::onAnimateTimer()
-{
-   if (visibleImage == imgDriver)
-      visibleImage = imgCar;
-   else
-      visibleImage = imgDriver;
-
-   updateDriverImage(labelImageSlot1->width(),
-                     labelImageSlot1->height());
-}
-
-//***************************************************************************
-// Paint Event
-//***************************************************************************
-
-void LinslotWindow::paintEvent(QPaintEvent* event)
-{
-   int static lastHeight = na;
-   int static lastWidth = na;
+   if (!raceRunning || query->getStatus() != success || !query->getRowCount())
+      return ;
 
-   // call inherited
+   // a lap driven meanwhile may be better already
 
-   QWidget::paintEvent(event);
+   long long record = query->value(0, 0).toLongLong();
 
-   // rescale image if nessecarry
+   if (record && (!trackRecord || record < trackRecord))
+      trackRecord = record;
 
-   if (lastHeight != labelImageSlot1->height()
-      || lastWidth != labelImageSlot1->width())
+   for (int i = 0; i < slotCount; i++)
    {
-      lastHeight = labelImageSlot1->height();
-      lastWidth = labelImageSlot1->width();
+      record = query->value(0, i+1).toLongLong();
 
-      updateDriverImage(lastWidth, lastHeight);
+      if (record && (!theSlots[i].personalBest || record < theSlots[i].personalBest))
+         theSlots[i].personalBest = record;
    }
 }
 
 //***************************************************************************
-// Open Db
+// Ghost Car Profile
+//  - loaded by the db service when a ghost car driver is selected,
+//    the start of the race must not wait for the database
 //***************************************************************************
 
-int LinslotWindow::openDb()
+void LinslotWindow::loadGcProfile()
 {
-   char dbPath[255];
-   int status;
+   theSlots[0].gcProfile = na;
+   gcReplayProfile.clear();
 
-   // db path
+   if (!dbService || QString(theSlots[0].driver).indexOf("GC: ") != 0)
+      return ;
 
-   sprintf(dbPath, "%s/%s", configPath.toAscii().constData(),
-           setupDialog->getDatabaseName());
+   dbService->submit(new GcProfileQuery(theSlots[0].driver + 4), this, "onGcProfileLoaded");
+}
 
-   // Open database via QT
+void LinslotWindow::onGcProfileLoaded(DbJob* job)
+{
+   GcProfileQuery* query = (GcProfileQuery*)job;
 
-   QSqlDatabase _db;
+   // the driver was changed meanwhile
 
-   _db = QSqlDatabase::addDatabase("QSQLITE");
-   _db.setDatabaseName(dbPath);
+   if (QString(theSlots[0].driver).indexOf("GC: ") != 0 || query->name != QString(theSlots[0].driver + 4))
+      return ;
 
-   if (!_db.open())
+   if (query->getStatus() != success)
    {
-      tell(eloAlways, "opening database failed :(");
-
-      if (!_db.isDriverAvailable("QSQLITE"))
-         QMessageBox::information(0, "Database", "QSQLITE is not available");
+      tell(eloAlways, "Profile for '%s' not found", theSlots[0].driver);
+      return ;
    }
 
-   // the old way, used for highscores
+   theSlots[0].gcProfile = query->profileId;
+   gcReplayProfile = query->profile;
+}
 
-   db = new SqliteDb(dbPath);
+void LinslotWindow::showRecordDelta(int slot, long long usec)
+{
+   QString info;
 
-   if ((status = db->open()) != success)
+   if (theSlots[slot].personalBest)
    {
-      tell(eloAlways, "Error: Open database '%s' failed. "  \
-           "Result was (%d)", dbPath, status);
+      long long delta = usec - theSlots[slot].personalBest;
+      info = "PB " + QString(delta > 0 ? "+" : "") + QString::number(delta/1000000.0, 'f', 3);
    }
 
-   else
+   if (trackRecord)
    {
-      if ((status = db->execute("select * from races;")) != success)
-      {
-         if (QMessageBox::question(this, "Warnung", "Tabellen nicht gefunden, anlegen?",
-                                   QMessageBox::Yes, QMessageBox::No) == QMessageBox::Yes)
-         {
-            createDb();
-
-            if ((status = db->execute("select * from races;")) != success)
-               QMessageBox::warning(this, "Fehler", "Tabellen konnten nicht angelegt werden!");
-         }
-      }
+      long long delta = usec - trackRecord;
+      info += "  TR " + QString(delta > 0 ? "+" : "") + QString::number(delta/1000000.0, 'f', 3);
    }
 
-   if (status != success)
-   {
-      db->close();
-      delete db;
-      db = 0;
-   }
+   if (!theSlots[slot].penalty)
+      theSlots[slot].labelInfo->setText(info);
 
-   return status;
+   if (!theSlots[slot].personalBest || usec < theSlots[slot].personalBest)
+      theSlots[slot].personalBest = usec;
+
+   if (!trackRecord || usec < trackRecord)
+      trackRecord = usec;
 }
 
 //***************************************************************************
-// Create Db
+// Show Lap Statistics
+//  - mean and deviation of the race, mean of the last laps
 //***************************************************************************
 
-int LinslotWindow::createDb()
+void LinslotWindow::showLapStatistics(int slot)
 {
-   QSqlQuery* query;
+   const LapStatistics& stats = theSlots[slot].stats;
 
-   tell(eloDebug, "Creating tables");
+   theSlots[slot].labelLastLap->setToolTip("Mittel " + QString::number(stats.getMean()/1000000.0, 'f', 3)
+                                           + "  " + QString::number(stats.getDeviation()/1000000.0, 'f', 3)
+                                           + "\nLetzte " + QString::number(stats.getWindowCount())
+                                           + " Runden " + QString::number(stats.getWindowMean()/1000000.0, 'f', 3));
 
-   query = new QSqlQuery("CREATE TABLE races ("                          \
-                         "RACE_ID INTEGER PRIMARY KEY AUTOINCREMENT, "    \
-                         "DRIVER1 INTEGER, "                             \
-                         "DRIVER2 INTEGER, "                             \
-                         "DATE DATETIME, "                               \
-                         "LAPS INTEGER, "                                \
-                         "LAP_LENGTH REAL, "                             \
-                         "COURSE TEXT"                                   \
-                         ");");
+   // below the record deltas written by showRecordDelta()
 
-   delete query;
+   if (!theSlots[slot].penalty && stats.getCount() > 1)
+   {
+      QString info = theSlots[slot].labelInfo->text();
 
-   query = new QSqlQuery("CREATE TABLE laps ("                         \
-                         "LAP_ID INTEGER PRIMARY KEY AUTOINCREMENT, "  \
-                         "RACE_ID INTEGER, "                           \
-                         "DRIVER_NR INTEGER, "                         \
-                         "LAP_NR INTEGER, "                            \
-                         "PROFILE_ID INTEGER, "                        \
-                         "LAP_TIME REAL"                               \
-                         ");");
+      if (!info.isEmpty())
+         info += "\n";
 
-   delete query;
+      theSlots[slot].labelInfo->setText(info + " " + QString::number(stats.getWindowMean()/1000000.0, 'f', 3)
+                                        + "  " + QString::number(stats.getDeviation()/1000000.0, 'f', 3));
+   }
 
-   query = new QSqlQuery("CREATE TABLE drivers ("                       \
-                         "DRIVER_ID INTEGER PRIMARY KEY AUTOINCREMENT, " \
-                         "NAME TEXT"                                    \
-                         ");");
+   emit lapStatisticsChanged(slot);
+}
 
-   delete query;
+//***************************************************************************
+// Update Driver Images
+//***************************************************************************
 
-   query = new QSqlQuery("CREATE TABLE courses ("                       \
-                         "COURSE_ID INTEGER PRIMARY KEY AUTOINCREMENT, " \
-                         "LENGTH REAL, "                                \
-                         "NAME TEXT"                                    \
-                         ");");
+void LinslotWindow::updateDriverImage(int width, int height)
+{
+   QSize size(width, height);
+   QString path;
+   QString other;
 
+   for (int i = 0; i < slotCount; i++)
+   {
+      QPixmap pixmap;
 
-   delete query;
+      if (visibleImage == imgDriver)
+      {
+         path = setupDialog->getDriverImage(theSlots[i].driver);
+         other = setupDialog->getCarImage(theSlots[i].car);
+      }
+      else
+      {
+         path = setupDialog->getCarImage(theSlots[i].car);
+         other = setupDialog->getDriverImage(theSlots[i].driver);
+      }
 
-   query = new QSqlQuery("CREATE TABLE profiles ("                      \
-                         "PROFILE_ID INTEGER PRIMARY KEY AUTOINCREMENT, " \
-                         "NAME TEXT, "                                  \
-                         "ACTIVE BOOLEAN, "                             \
-                         "COURSE TEXT, "                                \
-                         "COLOR TEXT, "                                 \
-                         "LAP_LENGTH REAL"                              \
-                         ");");
+      // request the other one too, the animation will need it
 
-   delete query;
+      if (other.size())
+         imageService->get(other, size, pixmap);
 
-   query = new QSqlQuery("CREATE TABLE lap_profiles ("                  \
-                         "LAP_PROFILE_ID INTEGER PRIMARY KEY AUTOINCREMENT, " \
-                         "PROFILE_ID INTEGER, "                         \
-                         "SEQUENCE INTEGER, "                           \
-                         "VOLT INTEGER, "                               \
-                         "AMPERE INTEGER"                               \
-                         ");");
+      int status = path.size() ? imageService->get(path, size, pixmap) : fail;
 
-   delete query;
+      if (status == success)
+      {
+         theSlots[i].labelImage->setPixmap(pixmap);
+      }
+      else if (status == fail)
+      {
+         theSlots[i].labelImage->clear();
+         theSlots[i].labelImage->setText(i == 1 ? ";)" : ":)");
+      }
 
-   return 0;
+      // else keep the current image until onImageReady()
+   }
 }
 
+void LinslotWindow::onImageReady()
+{
+   updateDriverImage(labelImageSlot1->width(),
+                     labelImageSlot1->height());
+}
 
 //***************************************************************************
-// Show Database
+// On Animation Timer
 //***************************************************************************
 
-int LinslotWindow::showDb()
+void LinslotWindow::onAnimateTimer()
 {
-   db->execute("SELECT r.DRIVER1, r.DRIVER2, r.DATE, l.LAP_TIME from races as r join laps as l where r.RACE_ID = 1 and l.RACE_ID = r.RACE_ID;");
-   db->show();
+   if (visibleImage == imgDriver)
+      visibleImage = imgCar;
+   else
+      visibleImage = imgDriver;
 
-   return 0;
+   updateDriverImage(labelImageSlot1->width(),
+                     labelImageSlot1->height());
 }
 
 //***************************************************************************
-// Store Race in Database
+// Paint Event
 //***************************************************************************
 
-int LinslotWindow::saveRace()
+void LinslotWindow::paintEvent(QPaintEvent* event)
 {
-   sqlite3_stmt* sqlInsertRace;
-   sqlite3_stmt* sqlInsertLap;
-   int status;
-   const char* duration;
-   int driver1, driver2;
-   // int courseId;
-
-   if (!*theSlots[0].driver || !*theSlots[1].driver)
-   {
-      QMessageBox::critical(this, "Fehler", "Kein Fahrer gewhlt!");
-      return 0;
-   }
-
-   driver1 = getDriverId(theSlots[0].driver);
-   driver2 = getDriverId(theSlots[1].driver);
-   // courseId = getCourseId();
-
-   db->prepare("INSERT INTO races(DRIVER1,DRIVER2,DATE,LAPS,LAP_LENGTH,COURSE) "\
-               "VALUES(?,?,datetime(?, 'unixepoch', 'utc'),?,?,?);",
-               sqlInsertRace);
-
-   db->prepare("INSERT INTO laps(RACE_ID,DRIVER_NR,LAP_NR,LAP_TIME) "\
-               "VALUES(?,?,?,?);",
-               sqlInsertLap);
-
-   db->execute("BEGIN;");
-
-   db->reset(sqlInsertRace);
-
-   db->bindInt(sqlInsertRace,    1, driver1);
-   db->bindInt(sqlInsertRace,    2, driver2);
-   db->bindInt(sqlInsertRace,    3, time(0));
-   db->bindInt(sqlInsertRace,    4, setupDialog->getLapCountRace());
-   db->bindDouble(sqlInsertRace, 5, setupDialog->getSlotLength());
-   db->bindText(sqlInsertRace,   6, setupDialog->getCourseName());
+   int static lastHeight = na;
+   int static lastWidth = na;
 
-   status = db->step(sqlInsertRace);
+   // call inherited
 
-   if (status != 0)
-      tell(eloAlways, "sqlite3_step(INSERT INTO races): '%s' (%d)",
-           db->lastError(), status);
+   QWidget::paintEvent(event);
 
-   int raceId = db->getInsertRowId();  // buggy ... ??
+   // rescale image if nessecarry
 
-   for (int l = 0; l < tableWidgetSlot1->rowCount(); l++)
+   if (lastHeight != labelImageSlot1->height()
+      || lastWidth != labelImageSlot1->width())
    {
-      db->reset(sqlInsertLap);
-
-      duration = 0;
-
-      if (tableWidgetSlot1->item(l, 1))
-         duration = tableWidgetSlot1->item(l, 0)->text().toAscii();
-
-      db->bindInt(sqlInsertLap, 1, raceId);       // RACE_ID
-      db->bindInt(sqlInsertLap, 2, driver1);      // DRIVER_NR
-      db->bindInt(sqlInsertLap, 3, l+1);          // LAP_NR
-
-      if (duration)
-         db->bindText(sqlInsertLap, 4, duration); // LAP_TIME
-      else
-         db->bindNull(sqlInsertLap, 4);           // LAP_TIME
-
-      status = db->step(sqlInsertLap);
+      lastHeight = labelImageSlot1->height();
+      lastWidth = labelImageSlot1->width();
 
-      if (status != 0)
-         tell(eloAlways, "sqlite3_step(INSERT INTO laps): %s (%d)",
-              db->lastError(), status);
+      updateDriverImage(lastWidth, lastHeight);
    }
+}
 
-   for (int l = 0; l < tableWidgetSlot2->rowCount(); l++)
-   {
-      db->reset(sqlInsertLap);
-
-      duration = 0;
-
-      if (tableWidgetSlot2->item(l, 1))
-         duration = tableWidgetSlot2->item(l, 0)->text().toAscii();
-
-      db->bindInt(sqlInsertLap, 1, raceId);       // RACE_ID
-      db->bindInt(sqlInsertLap, 2, driver2);      // DRIVER_NR
-      db->bindInt(sqlInsertLap, 3, l+1);          // LAP_NR
+//***************************************************************************
+// Class SchemaJob
+//  - check or upgrade the schema, the migrations use their own transaction
+//***************************************************************************
 
-      if (duration)
-         db->bindText(sqlInsertLap, 4, duration); // LAP_TIME
-      else
-         db->bindNull(sqlInsertLap, 4);           // LAP_TIME
+class SchemaJob : public DbJob
+{
+   public:
 
-      status = db->step(sqlInsertLap);
+      SchemaJob(int aUpgrade)
+         : DbJob()
+      {
+         upgrade = aUpgrade;
+         version = 0;
+         ownTransaction = yes;
+      }
 
-      if (status != 0)
-         tell(eloAlways, "sqlite3_step(INSERT INTO laps): %s (%d)",
-              db->lastError(), status);
-   }
+      int execute(SqliteDb* db)
+      {
+         Schema schema(db);
 
-   db->execute("COMMIT;");
+         version = schema.getVersion();
 
-   db->finalize(sqlInsertRace);
-   db->finalize(sqlInsertLap);
+         return upgrade ? schema.upgrade() : success;
+      }
 
-   return 0;
-}
+      int upgrade;
+      int version;
+};
 
 //***************************************************************************
-// Get Driver Id
+// Open Db
+//  - all database work is done by the db service thread
 //***************************************************************************
 
-int LinslotWindow::getDriverId(const char* driver)
+int LinslotWindow::openDb()
 {
-   sqlite3_stmt* sqlSelectDriver;
-   sqlite3_stmt* sqlInsertDriver;
-   char sql[1000+TB];
+   char dbPath[255];
    int status;
-   int id;
 
-   // get driver ID's
+   // db path
 
-   sprintf(sql, "SELECT * from drivers where NAME=?;");
-   db->prepare(sql, sqlSelectDriver);
-   db->bindText(sqlSelectDriver, 1, driver);
+   sprintf(dbPath, "%s/%s", configPath.toAscii().constData(),
+           setupDialog->getDatabaseName());
 
-   status = db->steps(sqlSelectDriver);
+   dbService = new DbService(dbPath);
 
-   db->reset(sqlSelectDriver);
-   db->finalize(sqlSelectDriver);
+   if ((status = dbService->open()) != success)
+   {
+      tell(eloAlways, "Error: Open database '%s' failed. "  \
+           "Result was (%d)", dbPath, status);
+   }
 
-   if (status == 0)
-      id = db->getIntValueOf("DRIVER_ID");
    else
    {
-      sprintf(sql, "INSERT INTO drivers(NAME) values(?);");
-      db->prepare(sql, sqlInsertDriver);
-      db->execute("BEGIN;");
-      db->bindText(sqlInsertDriver, 1, driver);
-      db->step(sqlInsertDriver);
-      db->execute("COMMIT;");
-      id = db->getInsertRowId();
-      db->finalize(sqlInsertDriver);
-   }
+      SchemaJob check(no);
+      SchemaJob upgrade(yes);
 
-   return id;
-}
+      dbService->call(&check);
 
-//***************************************************************************
-// Get Driver Id
-//***************************************************************************
+      if (check.version == 0
+          && QMessageBox::question(this, "Warnung", "Tabellen nicht gefunden, anlegen?",
+                                   QMessageBox::Yes, QMessageBox::No) != QMessageBox::Yes)
+      {
+         status = fail;
+      }
 
-int LinslotWindow::getCourseId()
-{
-   sqlite3_stmt* sqlSelect;
-   sqlite3_stmt* sqlInsert;
-   char sql[1000];
-   int status;
-   int id;
+      // create or upgrade the tables
 
-   // get driver ID's
+      else if ((status = dbService->call(&upgrade)) != success)
+      {
+         QMessageBox::warning(this, "Fehler", "Tabellen konnten nicht angelegt "
+                              "oder aktualisiert werden!");
+      }
 
-   sprintf(sql, "SELECT * from cources where NAME=?;");
-   db->prepare(sql, sqlSelect);
-   db->bindText(sqlSelect, 1, setupDialog->getCourseName());
+      // close the races left running by a crash
 
-   status = db->steps(sqlSelect);
+      else
+      {
+         char storePath[sizeof(dbPath)+10];
+         char* ext;
 
-   db->reset(sqlSelect);
-   db->finalize(sqlSelect);
+         dbService->recover();
 
-   if (status == 0)
-      id = db->getIntValueOf("COURSE_ID");
-   else
+         // race telemetry is kept in its own file next to the database,
+         //  named like it ('linslot.db' -> 'linslot.tss')
+
+         strcpy(storePath, dbPath);
+
+         if ((ext = strrchr(storePath, '.')) && !strchr(ext, '/'))
+            *ext = 0;
+
+         strcat(storePath, ".tss");
+         dbService->openStore(storePath);
+      }
+   }
+
+   if (status != success)
    {
-      sprintf(sql, "INSERT INTO courses(NAME,LENGTH) values(?,?);");
-      db->prepare(sql, sqlInsert);
-      db->execute("BEGIN;");
-      db->bindText(sqlInsert, 1, setupDialog->getCourseName());
-      db->bindDouble(sqlInsert, 2, setupDialog->getSlotLength());
-      db->step(sqlInsert);
-      db->execute("COMMIT;");
-      id = db->getInsertRowId();
-      db->finalize(sqlInsert);
+      delete dbService;
+      dbService = 0;
    }
 
-   return id;
+   return status;
 }
 
 //***************************************************************************
@@ -2186,22 +2490,113 @@ void LinslotWindow::on_toolButtonRecordGhostCar_clicked()
       labelFastLap->setText("abbruch");
       labelInfo->setText("Standby");
       tell(eloAlways, "GC aborted");
+      timerGcStop->stop();
       gcState = gcsOff;
       gcSlot = na;
    }
 }
 
+//***************************************************************************
+// Class GcStoreJob
+//  - stores a recorded ghost car profile with its values
+//***************************************************************************
+
+class GcStoreJob : public DbJob
+{
+   public:
+
+      GcStoreJob(const QString& aName, const QString& aCourse, double aLength,
+                 int aScale, const QList<unsigned short>& aValues)
+         : DbJob()
+      {
+         name = aName;
+         course = aCourse;
+         length = aLength;
+         scale = aScale;
+         values = aValues;
+      }
+
+      int execute(SqliteDb* db)
+      {
+         SqliteDb::Statement* stmt;
+         int profileId;
+
+         // create profile record
+
+         if (!(stmt = db->getStatement("INSERT INTO profiles("
+                                       "NAME, ACTIVE, COURSE, LAP_LENGTH, SCALE) "
+                                       "VALUES(?, 'true', ?, ?, ?);")))
+            return fail;
+
+         db->bindText(stmt,   1, name.toAscii().constData());
+         db->bindText(stmt,   2, course.toAscii().constData());
+         db->bindDouble(stmt, 3, length);
+         db->bindInt(stmt,    4, scale);
+
+         if (db->step(stmt) != success)
+         {
+            tell(eloAlways, "Fatal: Can't create profile '%s', %s",
+                 name.toAscii().constData(), db->lastError());
+            db->reset(stmt);
+
+            return fail;
+         }
+
+         profileId = db->getInsertRowId();
+         db->reset(stmt);
+
+         // create lap profile records
+
+         if (!(stmt = db->getStatement("INSERT INTO lap_profiles("
+                                       "PROFILE_ID, SEQUENCE, VOLT, AMPERE) "
+                                       "VALUES(?, ?, ?, ?);")))
+            return fail;
+
+         for (int i = 0; i < values.size(); i++)
+         {
+            db->bindInt(stmt, 1, profileId);
+            db->bindInt(stmt, 2, i);
+            db->bindInt(stmt, 3, values.at(i) & 0x00FF);
+            db->bindInt(stmt, 4, values.at(i) >> 8);
+
+            if (db->step(stmt) != success)
+            {
+               tell(eloAlways,  "Daten konnten nicht gespeichert werden (%d)!", i);
+               db->reset(stmt);
+
+               return fail;
+            }
+
+            db->reset(stmt);
+         }
+
+         tell(eloAlways, "Stored profile '%s' with (%d) values",
+              name.toAscii().constData(), values.size());
+
+         return success;
+      }
+
+   protected:
+
+      QString name;
+      QString course;
+      double length;
+      int scale;
+      QList<unsigned short> values;
+};
+
 //***************************************************************************
 // Store Ghostcar Data
 //***************************************************************************
 
 void LinslotWindow::storeGcRecording(QList<unsigned short>* values)
 {
-   QSqlQuery* insert = new QSqlQuery;
    bool ok = true;
    QString name = "";
    QString hint = "";
-   int profileId;
+
+   if (!dbService)
+      return ;
 
    while (ok)
    {
@@ -2213,67 +2608,25 @@ void LinslotWindow::storeGcRecording(QList<unsigned short>* values)
       {
          // name schon vergeben ... ?
 
-         QSqlQuery query("select NAME from profiles "
-                         "where NAME = '" + name + "';");
+         DbQuery query("select NAME from profiles where NAME = ?;");
 
-         if (!query.next())
+         query.bind(name);
+
+         if (dbService->call(&query) != success || !query.getRowCount())
             break ;
 
          hint = "Name bereits vergeben. ";
       }
    }
 
-   if (ok && !name.isEmpty())
-   {
-      // create profile record
-
-      insert->prepare("INSERT INTO profiles("
-                      "NAME, ACTIVE, COURSE, LAP_LENGTH) "
-                      "VALUES(:name, :active, :course, :length);");
-
-      insert->bindValue(":name", name);
-      insert->bindValue(":active", true);
-      insert->bindValue(":course", setupDialog->getCourseName());
-      insert->bindValue(":length", setupDialog->getSlotLength());
-      insert->exec();
-
-      // get id of new profile
-
-      QSqlQuery query("select PROFILE_ID from profiles "
-                      "where NAME = '" + name + "';");
-
-      if (!query.next())
-      {
-         tell(eloAlways, "Fatal: Can't find new created profile");
-         return ;
-      }
-
-      profileId = query.value(0).toInt();
-
-      // create lap profile records
+   // the values are written by the db service in the background
 
-      insert->prepare("INSERT INTO lap_profiles("
-                      "PROFILE_ID, SEQUENCE, VOLT, AMPERE) "
-                      "VALUES(:prid, :seq, :volt, :ampere);");
-
-      for (int i = 0; i < values->size(); i++)
-      {
-         insert->bindValue(":prid", profileId);
-         insert->bindValue(":seq", i);
-         insert->bindValue(":volt", values->at(i) & 0x00FF);
-         insert->bindValue(":ampere", values->at(i) >> 8);
-
-         if (!insert->exec())
-         {
-            tell(eloAlways,  "Daten konnten nicht gespeichert werden (%d)!", i);
-            break ;
-         }
-      }
-   }
+   if (ok && !name.isEmpty())
+      dbService->submit(new GcStoreJob(name, setupDialog->getCourseName(),
+                                       setupDialog->getSlotLength(),
+                                       thread->getGcScale(), *values));
 
    // applyOptions();
-
-   delete insert;
 }
 
 //***************************************************************************
@@ -2316,12 +2669,47 @@ void LinslotWindow::on_toolButtonSignalSlot2_released()
    simulateEvent(bitIrSlot2, no);
 }
 
+//***************************************************************************
+// Show Telemetry
+//  - not modal, the chart is fed while the race is running
+//***************************************************************************
+
+void LinslotWindow::on_toolButtonTelemetry_clicked()
+{
+   if (!telemetryDialog)
+   {
+      int average = (int)(setupDialog->getAverageLap() * 1000.0);
+      QVBoxLayout* layout = new QVBoxLayout;
+
+      telemetryDialog = new QDialog(this);
+      telemetry = new TelemetryChart(telemetryDialog);
+
+      // one lane per slot for the lap times [ms], one for the ghost car signals [%]
+
+      seriesLap[0] = telemetry->addSeries("Runden Spur 1", Qt::blue, 0, average / 2, average * 3 / 2);
+      seriesLap[1] = telemetry->addSeries("Runden Spur 2", Qt::red, 1, average / 2, average * 3 / 2);
+      seriesVolt = telemetry->addSeries("Spannung", Qt::darkGreen, 2, 0, 100);
+      seriesAmpere = telemetry->addSeries("Strom", Qt::darkYellow, 2, 0, 100, Qt::DotLine);
+
+      layout->addWidget(telemetry);
+      telemetryDialog->setLayout(layout);
+      telemetryDialog->setWindowTitle("Live");
+      telemetryDialog->resize(800, 450);
+   }
+
+   telemetryDialog->show();
+   telemetryDialog->raise();
+}
+
 //***************************************************************************
 // Show Profiles
 //***************************************************************************
 
 void LinslotWindow::on_toolButtonTest_clicked()
 {
+   if (!dbService)
+      return ;
+
    QDialog* profileDialog = new QDialog(this);
 
    RenderArea* renderArea = new RenderArea(this);
@@ -2337,19 +2725,14 @@ void LinslotWindow::on_toolButtonTest_clicked()
    QCheckBox* checkPower = new QCheckBox(this);
 
    QTableView* tableView = new QTableView(this);
-   QSqlTableModel* model = new QSqlTableModel(this);
+   QStandardItemModel* model = new QStandardItemModel(this);
    QSplitter* splitter = new QSplitter(this);
 
-   model->setTable("PROFILES");
-   model->removeColumn(model->fieldIndex("COLOR"));
-   model->removeColumn(model->fieldIndex("ACTIVE"));
-   model->setHeaderData(model->fieldIndex("PROFILE_ID"), Qt::Horizontal, "Id");
-   model->setHeaderData(model->fieldIndex("NAME"), Qt::Horizontal, "Name");
-   model->setHeaderData(model->fieldIndex("COURSE"), Qt::Horizontal, "Strecke");
-   model->setHeaderData(model->fieldIndex("LAP_LENGTH"), Qt::Horizontal, "Lnge");
-
-   model->select();
    tableView->setModel(model);
+   renderArea->setDbService(dbService);
+   renderArea->setTableView(tableView);
+   renderArea->reload();
+
    tableView->setSelectionBehavior(QAbstractItemView::SelectRows);
    tableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
    tableView->setMaximumSize(400, 9999999);
@@ -2409,8 +2792,6 @@ void LinslotWindow::on_toolButtonTest_clicked()
    profileDialog->setLayout(mainLayout);
    profileDialog->resize(1000, 600);
 
-   renderArea->setTableView(tableView);
-   renderArea->setGcScale(thread->getGcScale());
    tableView->resizeColumnsToContents();
    tableView->resizeRowsToContents();
 
@@ -24,6 +24,11 @@
 #include <highscore.hpp>
 #include <setup.hpp>
 #include <iothread.hpp>
+#include <dbservice.hpp>
+#include <statistics.hpp>
+#include <imageservice.hpp>
+#include <telemetry.hpp>
+#include <laptelemetry.hpp>
 
 //***************************************************************************
 // Class LinslotWindow
@@ -43,7 +48,9 @@ class LinslotWindow : public QMainWindow, private Ui::LinslotWindow, public Slot
          bitsPerByte    = 8,
 
          bounceTime     = 30000,    // Seconds (0.03 sec)
-         slotCount      = 2
+         slotCount      = 2,
+         minPaceLaps    = 3,        // laps before the fuel model uses the driver's pace
+         gcStopTimeout  = 2000      // ms to wait for the last ghost car block
       };
 
       enum PowerState
@@ -106,6 +113,7 @@ class LinslotWindow : public QMainWindow, private Ui::LinslotWindow, public Slot
          gcsOff,
          gcsWaitingStart,
          gcsRecording,
+         gcsStopping,              // waiting for the last block of the board
          gcsRunning
       };
 
@@ -115,6 +123,14 @@ class LinslotWindow : public QMainWindow, private Ui::LinslotWindow, public Slot
          imgCar
       };
 
+      struct LedView
+      {
+         QList<QLabel*> labels;       // the labels showing this led (indent == led id)
+         QPixmap on;
+         QPixmap off;
+         int state;                   // na until drawn the first time
+      };
+
       struct Slot
       {
          timeval lastSignal;
@@ -126,6 +142,8 @@ class LinslotWindow : public QMainWindow, private Ui::LinslotWindow, public Slot
          double fuelLevel;            // fuel level
          int fueling;
          int gcProfile;
+         long long personalBest;      // [us] 0 if unknown
+         LapStatistics stats;         // laps of the running race
          QString getDriver() { return comboDriver->currentText();}
          QString getCar()    { return comboCar->currentText();}
 
@@ -152,6 +170,12 @@ class LinslotWindow : public QMainWindow, private Ui::LinslotWindow, public Slot
       void initRace();
       void ioOpened();
 
+      const LapStatistics& getLapStatistics(int slot)  { return theSlots[slot].stats; }
+
+   signals:
+
+      void lapStatisticsChanged(int slot);
+
    protected:
 
       // functions
@@ -168,6 +192,9 @@ class LinslotWindow : public QMainWindow, private Ui::LinslotWindow, public Slot
       void atStop(const char* info);
 
       int getImagesFor(int led, const char* &ledOn, const char* &ledOff);
+      int indexOfLed(int led);
+      void initLeds();
+      void loadLedImages();
       void setOutputs(int mask);
       void switchOutputs(int mask, int state);
       void setLed(int function, int state);
@@ -192,17 +219,17 @@ class LinslotWindow : public QMainWindow, private Ui::LinslotWindow, public Slot
       void atFuelTimer(int slot);
       void decrementFuel(int slot, unsigned int usec);
       void storeGcRecording(QList<unsigned short>* values);
+      void loadGcProfile();
       void updateDriverImage(int width, int height);
       void paintEvent(QPaintEvent* event);
+      void showRecordDelta(int slot, long long usec);
+      void showLapStatistics(int slot);
+      void storeTelemetry(int slot, int cycle, const QList<TelemetryRecorder::Lap>& laps);
+      void flushTelemetry();
 
       // db stuff
 
       int openDb();
-      int createDb();
-      int saveRace();
-      int showDb();
-      int getDriverId(const char* driver);
-      int getCourseId();
 
       // data
 
@@ -213,19 +240,22 @@ class LinslotWindow : public QMainWindow, private Ui::LinslotWindow, public Slot
       QTimer* timerElapsed;
       QTimer* timerPenalty;
       QTimer* timerAnimateImage;
+      QTimer* timerGcStop;
       Slot theSlots[slotCount];
       timeval raceStart;
       int raceRunning;
       int countdownStarted;
       int countdown;
-      QObject* ledsParent;
+      LedView ledViews[ledCount];
       double fastLapTime;
+      long long trackRecord;          // [us] 0 if unknown
       int withSound;
       byte oldSpiSetting;
       int visibleImage;
       int supressComboBoxUpdate;
 
-      SqliteDb* db;
+      DbService* dbService;
+      ImageService* imageService;
 
       char* resourcePath;
       QString configPath;
@@ -233,11 +263,26 @@ class LinslotWindow : public QMainWindow, private Ui::LinslotWindow, public Slot
       QList<unsigned short> gcValues;
       int gcState;
       int gcSlot;
+      GcProfile gcReplayProfile;     // of the ghost car driver selected in slot 1
 
       // dialogs
 
       SetupDialog* setupDialog;
       HighscoreDialog* highscoreDialog;
+      QDialog* telemetryDialog;
+
+      // live chart, 0 until opened
+
+      TelemetryChart* telemetry;
+      int seriesLap[slotCount];
+      int seriesVolt;
+      int seriesAmpere;
+
+      // race telemetry, volt and ampere of each slot cut into laps
+
+      TelemetryRecorder recorders[slotCount];
+      int telemetryStopPending;      // recorders wait for the last samples
+      int finishPending;             // race finished, queued after the last samples
 
       int outputFunctionState[fctOutputCount];
 
@@ -245,14 +290,20 @@ class LinslotWindow : public QMainWindow, private Ui::LinslotWindow, public Slot
 
       void onDigitalInput(const DigitalEvent ioEvent);
       void onAnalogInput(const AnalogEvent ioEvent);
+      void onTelemetry(const TelemetryEvent ioEvent);
+      void onTelemetryStop();
+      void onGhostCarRecorded();
+      void onGhostCarStopTimeout();
       void onDeviceConnected(int state);
+      void onRecordsLoaded(DbJob* job);
+      void onGcProfileLoaded(DbJob* job);
 
       void on_pushButtonPower_clicked();
-      void on_pushButtonSaveToDb_clicked();
       void on_pushButtonHallOfFame_clicked();
       void on_pushButtonStartRace_clicked();
       void on_pushButtonOptions_clicked();
       void on_toolButtonTest_clicked();
+      void on_toolButtonTelemetry_clicked();
       void on_toolButtonRecordGhostCar_clicked();
       void onTimer();
       void onTimerFlash();
@@ -261,6 +312,7 @@ class LinslotWindow : public QMainWindow, private Ui::LinslotWindow, public Slot
       void onElapsedTimer();
       void onPenaltyTimer();
       void onAnimateTimer();
+      void onImageReady();
       void onOptionsAccepted();
       void on_comboBoxDriver1_currentIndexChanged(QString value);
       void on_comboBoxDriver2_currentIndexChanged(QString value);
@@ -19,8 +19,6 @@ interface = arduino
 TEMPLATE  = app
 CONFIG    += qt debug
 
-QT += sql
-
 FORMS       = linslot.ui setup.ui highscore.ui
 
 DEPENDPATH  += .
@@ -28,11 +26,17 @@ INCLUDEPATH += .
 LIBS        += -lsqlite3
 HEADERS     += linslot.hpp iothread.hpp common.hpp iointerface.hpp \
                setup.hpp sqlite.hpp list.hpp highscore.hpp \
-               iointerface.hpp lapprofile.hpp delegateitems.hpp arduino.hpp
+               iointerface.hpp lapprofile.hpp delegateitems.hpp arduino.hpp \
+               gcprofile.hpp logger.hpp trace.hpp schema.hpp dbservice.hpp \
+               statistics.hpp imageservice.hpp telemetry.hpp \
+               laptelemetry.hpp tsstore.hpp journal.hpp
 
 SOURCES     += main.cc arduino.cc linslot.cc iothread.cc common.cc \
                setup.cc sqlite.cc list.cc highscore.cc \
-               iointerface.cc lapprofile.cc delegateitems.cc
+               iointerface.cc lapprofile.cc delegateitems.cc gcprofile.cc \
+               logger.cc trace.cc schema.cc dbservice.cc \
+               statistics.cc imageservice.cc telemetry.cc \
+               laptelemetry.cc tsstore.cc journal.cc
 
 # Linux / Unix
 
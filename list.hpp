@@ -6,80 +6,111 @@
 // GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
 //***************************************************************************
 
+#ifndef _LIST_H_
+#define _LIST_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+//***************************************************************************
+// Allocation Counter
+//  - counts the heap allocations of Array and Arena
+//***************************************************************************
+
+extern long containerAllocations;
+
 //*************************************************************************
-// Klasse List
+// Klasse Array
+//  - contiguous, type safe container, grows by doubling,
+//    clear() keeps the memory for the next use
 //*************************************************************************
 
-class List
+template <class T> class Array
 {
    public:
 
-      // Konstruktor & Destruktor
+      Array()                        { items = 0; count = 0; size = 0; }
+      ~Array()                       { delete[] items; }
 
-      enum Misc
+      // interface
+
+      void append(const T& item)     { if (count >= size) reserve(size ? size * 2 : 16); items[count++] = item; }
+      void clear()                   { count = 0; }
+
+      void reserve(int n)
       {
-         success = 0,
-         done    = success,
-         fail    = -1,
+         T* p;
 
-         no      = 0,
-         yes     = 1
-      };
+         if (n <= size)
+            return ;
 
-      List();
-      ~List(); 
+         p = new T[n];
+         containerAllocations++;
 
-      // interface
+         for (int i = 0; i < count; i++)
+            p[i] = items[i];
 
-      int insert(void *item);
-      int append(void *item);
-      int remove(void *item);
-      int removeCurrent();
+         delete[] items;
+         items = p;
+         size = n;
+      }
 
-      int removeAll();
-      int freeAll();
+      // gettings
 
-      // settings
+      T& operator[](int i)           { return items[i]; }
+      T* getAt(int i)                { return i >= 0 && i < count ? &items[i] : 0; }
+      int getCount()                 { return count; }
+      int isEmpty()                  { return count == 0; }
 
-      int setPosition(long i)   { Node* p = nodeAt(i); current = p ? p : current; return p ? success : fail; }
+   protected:
 
-      // gettings      
+      T* items;
+      int count;
+      int size;
 
-      void* getFirst();
-      void* getNext();
-      void* getPrevious();
-      void* getLast();
-      void* getCurrent();
-      void* getAt(int i)    { return nodeAt(i) ? nodeAt(i)->item : 0; }
-      int getCount()        { return count; }
-      
-      int isEmpty()         { return count == 0; }
+   private:
 
-      int pushPosition();
-      int popPosition();
-      int removePushedPositions();
+      Array(const Array&);
+      Array& operator=(const Array&);
+};
 
-   protected:
+//*************************************************************************
+// Klasse Arena
+//  - string storage in big blocks, released at once by reset()
+//*************************************************************************
 
-      // Typ Node
+class Arena
+{
+   public:
 
-      struct Node
+      enum Misc
       {
-         void* item;
+         blockSize = 64 * 1024
+      };
+
+      Arena();
+      ~Arena();
+
+      // interface
+
+      char* alloc(int size);
+      char* strdup(const char* s);
+      void reset();
+
+   protected:
 
-         Node* prev;
-         Node* next;
+      struct Block
+      {
+         Block* next;
+         int size;
+         int used;
+         char data[1];
       };
 
-      int insertNode(Node* node, int after);
-      int appendNode(Node* node);
-      Node* nodeAt(int index);
-   
-      // register
+      Block* newBlock(int size);
 
-      int count;
-      Node* first;
-      Node* last;
-      Node* current;
-      Node* pushedPos;
+      Block* blocks;                 // current block first
 };
+
+//***************************************************************************
+#endif // _LIST_H_
@@ -0,0 +1,262 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File logger.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <stdio.h>
+#include <string.h>
+
+#include <logger.hpp>
+
+QAtomicPointer<Logger> Logger::instance = 0;
+QAtomicInt Logger::producers = 0;
+
+//***************************************************************************
+// Object
+//***************************************************************************
+
+Logger::Logger(QString file)
+   : QThread()
+{
+   for (int i = 0; i < ringSize; i++)
+      ring[i].sequence = i;
+
+   enqueuePos = 0;
+   dequeuePos = 0;
+   dropped = 0;
+   dropReported = 0;
+   running = no;
+   fileName = file;
+}
+
+Logger::~Logger()
+{
+   if (file.isOpen())
+      file.close();
+}
+
+//***************************************************************************
+// Start / Stop Writer
+//***************************************************************************
+
+int Logger::startWriter(QString file)
+{
+   Logger* logger;
+
+   if (instance)
+      return done;
+
+   logger = new Logger(file);
+
+   if (file.size())
+   {
+      logger->file.setFileName(file);
+
+      if (!logger->file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Append))
+      {
+         tell(eloAlways, "Opening log file '%s' failed, logging synchronous",
+              file.toAscii().constData());
+         delete logger;
+
+         return fail;
+      }
+   }
+
+   logger->running = yes;
+   logger->start(QThread::LowPriority);
+   instance = logger;
+
+   return success;
+}
+
+void Logger::stopWriter()
+{
+   // back to synchronous logging first, no new producer can reach the ring now
+
+   Logger* logger = instance.fetchAndStoreOrdered(0);
+
+   if (!logger)
+      return ;
+
+   // wait for producers which got the instance before we cleared it
+
+   while (producers != 0)
+      QThread::yieldCurrentThread();
+
+   logger->running = no;
+   logger->wait();
+
+   logger->flush();
+
+   delete logger;
+}
+
+//***************************************************************************
+// Push
+//***************************************************************************
+
+int Logger::push(const char* format, va_list ap)
+{
+   int res;
+
+   producers.ref();
+
+   Logger* logger = instance;
+
+   if (!logger)
+   {
+      producers.deref();
+      return fail;               // writer stopped meanwhile, ap is untouched
+   }
+
+   res = logger->enqueue(format, ap);
+   producers.deref();
+
+   return res;
+}
+
+//***************************************************************************
+// Enqueue
+//  - claim a slot, each slot carries a sequence number which tells
+//    whether it's free (== pos) or filled (== pos + 1) in this round
+//***************************************************************************
+
+int Logger::enqueue(const char* format, va_list ap)
+{
+   Entry* entry;
+   int pos;
+
+   for (;;)
+   {
+      pos = enqueuePos;
+      entry = &ring[pos & (ringSize-1)];
+      int diff = (int)((unsigned int)(int)entry->sequence - (unsigned int)pos);
+
+      if (diff == 0)
+      {
+         if (enqueuePos.testAndSetRelaxed(pos, pos + 1))
+            break;
+      }
+      else if (diff < 0)
+      {
+         // ring full, the writer can't keep up, the drop is
+         // reported by the writer - don't write it synchronous
+
+         dropped.ref();
+         return success;
+      }
+
+      // else another thread was faster, try again
+   }
+
+   gettimeofday(&entry->tp, 0);
+   vsnprintf(entry->message, maxMessage, format, ap);
+
+   entry->sequence.fetchAndStoreRelease(pos + 1);
+
+   return success;
+}
+
+//***************************************************************************
+// Run
+//***************************************************************************
+
+void Logger::run()
+{
+   while (running)
+   {
+      if (flush() == 0)
+         msleep(writeInterval);
+   }
+}
+
+//***************************************************************************
+// Flush
+//  - write all pending messages in one batch, returns the count
+//***************************************************************************
+
+int Logger::flush()
+{
+   const int sizeLine = maxMessage + 50;
+
+   QByteArray batch;
+   char line[sizeLine+TB];
+   int count = 0;
+   int lost;
+
+   for (;;)
+   {
+      Entry* entry = &ring[dequeuePos & (ringSize-1)];
+      int diff = (int)((unsigned int)(int)entry->sequence - (dequeuePos + 1));
+
+      if (diff < 0)
+         break;                  // empty
+
+      format(line, sizeLine, &entry->tp, entry->message);
+      batch.append(line);
+      batch.append('\n');
+
+      entry->sequence.fetchAndStoreRelease(dequeuePos + ringSize);
+      dequeuePos++;
+      count++;
+   }
+
+   if ((lost = dropped) != dropReported)
+   {
+      timeval tp;
+
+      gettimeofday(&tp, 0);
+      snprintf(line, sizeLine, "Warning: Logger dropped (%d) messages", lost - dropReported);
+      format(line, sizeLine, &tp, QByteArray(line).constData());
+      batch.append(line);
+      batch.append('\n');
+      dropReported = lost;
+   }
+
+   if (batch.isEmpty())
+      return 0;
+
+   if (file.isOpen())
+   {
+      file.write(batch);
+      file.flush();
+   }
+   else
+   {
+      fwrite(batch.constData(), 1, batch.size(), stdout);
+      fflush(stdout);
+   }
+
+   return count;
+}
+
+//***************************************************************************
+// Format
+//  - "yy.mm.dd HH:MM:SS,mmm message"
+//***************************************************************************
+
+int Logger::format(char* buf, int size, const timeval* tp, const char* msg)
+{
+   struct tm tm;
+   time_t t = tp->tv_sec;
+   char date[50];
+
+#ifdef Q_OS_WIN32
+   tm = *localtime(&t);
+#else
+   localtime_r(&t, &tm);
+#endif
+
+   strftime(date, sizeof(date), "%y.%m.%d %H:%M:%S", &tm);
+
+   return snprintf(buf, size, "%s,%3.3ld %s", date, (long)(tp->tv_usec / 1000), msg);
+}
+
+//***************************************************************************
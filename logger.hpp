@@ -0,0 +1,85 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File logger.hpp
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+#ifndef _LOGGER_H_
+#define _LOGGER_H_
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <stdarg.h>
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QFile>
+
+#include <common.hpp>
+
+//***************************************************************************
+// Class Logger
+//  - lock free multi producer / single consumer ring for the log messages,
+//    the caller only takes the time and formats the message into a free
+//    slot, the writer thread adds the date header and writes in batches
+//***************************************************************************
+
+class Logger : public QThread
+{
+   public:
+
+      enum Misc
+      {
+         ringSize = 1024,              // power of 2
+         maxMessage = 1000,            // same as the synchronous vtell()
+         writeInterval = 20            // [ms]
+      };
+
+      // interface
+
+      static int startWriter(QString file);
+      static void stopWriter();
+      static int isActive()            { return instance != 0; }
+      static int push(const char* format, va_list ap);
+
+      static int format(char* buf, int size, const timeval* tp, const char* msg);
+
+   protected:
+
+      struct Entry
+      {
+         QAtomicInt sequence;
+         timeval tp;
+         char message[maxMessage+TB];
+      };
+
+      Logger(QString file);
+      virtual ~Logger();
+
+      void run();
+      int enqueue(const char* format, va_list ap);
+      int flush();
+
+      // data
+
+      Entry ring[ringSize];
+      QAtomicInt enqueuePos;
+      unsigned int dequeuePos;         // used by the writer thread only
+      QAtomicInt dropped;
+      int dropReported;
+      QAtomicInt running;
+
+      QString fileName;
+      QFile file;
+
+      static QAtomicPointer<Logger> instance;
+      static QAtomicInt producers;     // threads currently inside push()
+};
+
+//***************************************************************************
+#endif // _LOGGER_H_
@@ -0,0 +1,332 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File schema.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <stdio.h>
+
+#include <schema.hpp>
+
+//***************************************************************************
+// Migrations
+//  - append only, never change a released one!
+//***************************************************************************
+
+Schema::Migration Schema::migrations[] =
+{
+   { 1, "initial tables",
+     {
+        "CREATE TABLE races ("
+        "RACE_ID INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "DRIVER1 INTEGER, "
+        "DRIVER2 INTEGER, "
+        "DATE DATETIME, "
+        "LAPS INTEGER, "
+        "LAP_LENGTH REAL, "
+        "COURSE TEXT);",
+
+        "CREATE TABLE laps ("
+        "LAP_ID INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "RACE_ID INTEGER, "
+        "DRIVER_NR INTEGER, "
+        "LAP_NR INTEGER, "
+        "PROFILE_ID INTEGER, "
+        "LAP_TIME REAL);",
+
+        "CREATE TABLE drivers ("
+        "DRIVER_ID INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "NAME TEXT);",
+
+        "CREATE TABLE courses ("
+        "COURSE_ID INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "LENGTH REAL, "
+        "NAME TEXT);",
+
+        "CREATE TABLE profiles ("
+        "PROFILE_ID INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "NAME TEXT, "
+        "ACTIVE BOOLEAN, "
+        "COURSE TEXT, "
+        "COLOR TEXT, "
+        "LAP_LENGTH REAL);",
+
+        "CREATE TABLE lap_profiles ("
+        "LAP_PROFILE_ID INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "PROFILE_ID INTEGER, "
+        "SEQUENCE INTEGER, "
+        "VOLT INTEGER, "
+        "AMPERE INTEGER);",
+        0
+     }
+   },
+
+   { 2, "sample intervall of the profiles, NULL for the old 100ms recordings",
+     {
+        "ALTER TABLE profiles ADD COLUMN SCALE INTEGER;",
+        0
+     }
+   },
+
+   { 3, "lap time as integer microseconds",
+     {
+        "CREATE TABLE laps_new ("
+        "LAP_ID INTEGER PRIMARY KEY AUTOINCREMENT, "
+        "RACE_ID INTEGER, "
+        "DRIVER_NR INTEGER, "
+        "LAP_NR INTEGER, "
+        "PROFILE_ID INTEGER, "
+        "LAP_TIME INTEGER);",
+
+        "INSERT INTO laps_new(LAP_ID,RACE_ID,DRIVER_NR,LAP_NR,PROFILE_ID,LAP_TIME) "
+        "SELECT LAP_ID, RACE_ID, DRIVER_NR, LAP_NR, PROFILE_ID, "
+        "CASE WHEN LAP_TIME IS NULL OR LAP_TIME = '' THEN NULL "
+        "ELSE CAST(ROUND(LAP_TIME * 1000000) AS INTEGER) END "
+        "FROM laps;",
+
+        "DROP TABLE laps;",
+        "ALTER TABLE laps_new RENAME TO laps;",
+        0
+     }
+   },
+
+   { 4, "indexes",
+     {
+        "CREATE INDEX idx_laps_race ON laps(RACE_ID, DRIVER_NR, LAP_NR);",
+        "CREATE INDEX idx_laps_time ON laps(LAP_TIME);",
+        "CREATE INDEX idx_drivers_name ON drivers(NAME);",
+        "CREATE INDEX idx_lap_profiles_profile ON lap_profiles(PROFILE_ID);",
+        0
+     }
+   },
+
+   { 5, "race state, the laps are stored while the race is running",
+     {
+        "ALTER TABLE races ADD COLUMN STATE INTEGER;",
+        "UPDATE races SET STATE = 1;",
+        "CREATE INDEX idx_races_state ON races(STATE);",
+        0
+     }
+   },
+
+   { 6, "cars of the races, records per driver, car, course and lap length",
+     {
+        "ALTER TABLE races ADD COLUMN CAR1 TEXT;",
+        "ALTER TABLE races ADD COLUMN CAR2 TEXT;",
+
+        "CREATE TABLE records ("
+        "DRIVER_ID INTEGER NOT NULL, "
+        "CAR TEXT NOT NULL, "
+        "COURSE TEXT NOT NULL, "
+        "LAP_LENGTH REAL NOT NULL, "
+        "LAPS INTEGER, "
+        "RACES INTEGER, "
+        "BEST_LAP INTEGER, "
+        "BEST_LAP_ID INTEGER, "
+        "BEST_RACE INTEGER, "
+        "BEST_RACE_ID INTEGER, "
+        "PRIMARY KEY (DRIVER_ID, CAR, COURSE, LAP_LENGTH));",
+
+        "CREATE INDEX idx_records_course ON records(COURSE, LAP_LENGTH, BEST_LAP);",
+
+        // the laps with the key of their record
+
+        "CREATE VIEW record_laps AS SELECT "
+        "l.LAP_ID AS LAP_ID, l.RACE_ID AS RACE_ID, l.LAP_TIME AS LAP_TIME, r.STATE AS STATE, "
+        "l.DRIVER_NR AS DRIVER_ID, "
+        "ifnull(CASE WHEN l.DRIVER_NR = r.DRIVER1 THEN r.CAR1 ELSE r.CAR2 END, '') AS CAR, "
+        "ifnull(r.COURSE, '') AS COURSE, "
+        "ifnull(r.LAP_LENGTH, 0) AS LAP_LENGTH "
+        "FROM laps AS l JOIN races AS r ON r.RACE_ID = l.RACE_ID "
+        "WHERE l.LAP_TIME IS NOT NULL;",
+        0
+     }
+   },
+
+   { 7, "race telemetry, the coded volt and ampere samples of each lap",
+     {
+        "CREATE TABLE lap_telemetry ("
+        "LAP_ID INTEGER PRIMARY KEY, "
+        "RACE_ID INTEGER NOT NULL, "
+        "SLOT INTEGER NOT NULL, "
+        "LAP_NR INTEGER NOT NULL, "
+        "CYCLE INTEGER NOT NULL, "
+        "COUNT INTEGER NOT NULL, "
+        "VOLTS BLOB, "
+        "AMPERES BLOB);",
+
+        "CREATE INDEX idx_lap_telemetry_race ON lap_telemetry(RACE_ID, SLOT, LAP_NR);",
+        0
+     }
+   },
+
+   { 8, "lane of the laps, the same driver may race in both lanes",
+     {
+        "ALTER TABLE laps ADD COLUMN SLOT INTEGER;",
+
+        // the lane of the older laps is known by its driver only
+
+        "UPDATE laps SET SLOT = (SELECT CASE laps.DRIVER_NR WHEN r.DRIVER1 THEN 0 WHEN r.DRIVER2 THEN 1 END "
+        "FROM races AS r WHERE r.RACE_ID = laps.RACE_ID AND r.DRIVER1 <> r.DRIVER2);",
+
+        "DROP VIEW record_laps;",
+
+        "CREATE VIEW record_laps AS SELECT "
+        "l.LAP_ID AS LAP_ID, l.RACE_ID AS RACE_ID, l.LAP_TIME AS LAP_TIME, r.STATE AS STATE, "
+        "l.DRIVER_NR AS DRIVER_ID, "
+        "ifnull(CASE WHEN ifnull(l.SLOT, CASE WHEN l.DRIVER_NR = r.DRIVER1 THEN 0 ELSE 1 END) = 0 "
+        "THEN r.CAR1 ELSE r.CAR2 END, '') AS CAR, "
+        "ifnull(r.COURSE, '') AS COURSE, "
+        "ifnull(r.LAP_LENGTH, 0) AS LAP_LENGTH "
+        "FROM laps AS l JOIN races AS r ON r.RACE_ID = l.RACE_ID "
+        "WHERE l.LAP_TIME IS NOT NULL;",
+        0
+     }
+   },
+
+   { 0, 0, { 0 } }
+};
+
+//***************************************************************************
+// Object
+//***************************************************************************
+
+Schema::Schema(SqliteDb* aDb)
+{
+   db = aDb;
+}
+
+//***************************************************************************
+// Get Version
+//  - databases created before the versioning have no 'schema_version',
+//    their version is derived from the tables
+//***************************************************************************
+
+int Schema::getVersion()
+{
+   if (hasTable("schema_version"))
+   {
+      SqliteDb::Cursor cursor(db, "SELECT max(VERSION) FROM schema_version;");
+
+      return cursor.next() ? cursor.getInt(0) : 0;
+   }
+
+   if (!hasTable("races"))
+      return 0;
+
+   return hasColumn("profiles", "SCALE") ? 2 : 1;
+}
+
+int Schema::getLatestVersion()
+{
+   int version = 0;
+
+   for (int i = 0; migrations[i].version; i++)
+      version = migrations[i].version;
+
+   return version;
+}
+
+//***************************************************************************
+// Upgrade
+//***************************************************************************
+
+int Schema::upgrade()
+{
+   int version = getVersion();
+
+   if (version > getLatestVersion())
+   {
+      tell(eloAlways, "Warning: Database schema version (%d) is newer than this "
+           "program (%d)", version, getLatestVersion());
+      return done;
+   }
+
+   if (!hasTable("schema_version"))
+   {
+      char sql[100+TB];
+
+      db->execute("CREATE TABLE schema_version (VERSION INTEGER);");
+      sprintf(sql, "INSERT INTO schema_version(VERSION) values(%d);", version);
+      db->execute(sql);
+   }
+
+   for (int i = 0; migrations[i].version; i++)
+   {
+      if (migrations[i].version <= version)
+         continue;
+
+      if (apply(&migrations[i]) != success)
+         return fail;
+   }
+
+   return success;
+}
+
+//***************************************************************************
+// Apply
+//***************************************************************************
+
+int Schema::apply(const Migration* migration)
+{
+   char sql[100+TB];
+
+   tell(eloAlways, "Upgrading database to version (%d), %s",
+        migration->version, migration->description);
+
+   db->execute("BEGIN;");
+
+   for (int i = 0; migration->statements[i]; i++)
+   {
+      if (db->execute(migration->statements[i]) != success)
+      {
+         tell(eloAlways, "Error: Upgrade to version (%d) failed at '%s', %s",
+              migration->version, migration->statements[i], db->lastError());
+         db->execute("ROLLBACK;");
+
+         return fail;
+      }
+   }
+
+   sprintf(sql, "UPDATE schema_version SET VERSION = %d;", migration->version);
+   db->execute(sql);
+   db->execute("COMMIT;");
+
+   return success;
+}
+
+//***************************************************************************
+// Has Table / Column
+//***************************************************************************
+
+int Schema::hasTable(const char* table)
+{
+   SqliteDb::Cursor cursor(db, "SELECT 1 FROM sqlite_master WHERE type='table' and name=?;");
+
+   db->bindText(cursor.getStatement(), 1, table);
+
+   return cursor.next();
+}
+
+int Schema::hasColumn(const char* table, const char* column)
+{
+   char sql[100+TB];
+
+   snprintf(sql, 100, "PRAGMA table_info(%s);", table);
+
+   SqliteDb::Cursor cursor(db, sql);
+
+   while (cursor.next())
+   {
+      if (strcasecmp(cursor.getText(1), column) == 0)
+         return yes;
+   }
+
+   return no;
+}
@@ -0,0 +1,60 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File schema.hpp
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+#ifndef _SCHEMA_H_
+#define _SCHEMA_H_
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <sqlite.hpp>
+
+//***************************************************************************
+// Class Schema
+//  - versioned database schema, the migrations are applied in order,
+//    each in its own transaction, the reached version is stored in
+//    the table 'schema_version'
+//***************************************************************************
+
+class Schema
+{
+   public:
+
+      struct Migration
+      {
+         int version;
+         const char* description;
+         const char* statements[10];    // 0 terminated
+      };
+
+      // object
+
+      Schema(SqliteDb* aDb);
+
+      // interface
+
+      int getVersion();
+      int getLatestVersion();
+      int upgrade();
+
+   protected:
+
+      int hasTable(const char* table);
+      int hasColumn(const char* table, const char* column);
+      int apply(const Migration* migration);
+
+      // data
+
+      SqliteDb* db;
+
+      static Migration migrations[];
+};
+
+//***************************************************************************
+#endif // _SCHEMA_H_
@@ -70,6 +70,7 @@ SetupDialog::SetupDialog(QString configPath)
    fuelingActive = settings->value("fuelingActive", yes).toInt();
    fuelPenaltyTime = settings->value("fuelPenaltyTime", 5).toInt();
    withSpiExtension = settings->value("withSpiExtension", true).toBool();
+   telemetryActive = settings->value("telemetryActive", no).toInt();
    driverImageMode = settings->value("driverImageMode", mdAnimated).toInt();
    animationInterval = settings->value("animationInterval", 5).toInt();
    settings->endGroup();
@@ -245,6 +246,7 @@ SetupDialog::SetupDialog(QString configPath)
    groupBoxFueling->setEnabled(fuelingActive);
    spinBoxFuelPenaltyTime->setValue(fuelPenaltyTime);
    checkBoxWithSpiExtension->setChecked(withSpiExtension);
+   checkBoxTelemetry->setChecked(telemetryActive);
 
    if (abortAtJumpTheGun)
       radioButtonJumpTheGunAbort->setChecked(true);
@@ -483,6 +485,7 @@ SetupDialog::~SetupDialog()
    settings->setValue("fuelingActive", fuelingActive);
    settings->setValue("fuelPenaltyTime", fuelPenaltyTime);
    settings->setValue("withSpiExtension", withSpiExtension);
+   settings->setValue("telemetryActive", telemetryActive);
    settings->setValue("driverImageMode", driverImageMode);
    settings->setValue("animationInterval", animationInterval);
 
@@ -1006,6 +1009,11 @@ void SetupDialog::on_checkBoxWithSpiExtension_stateChanged(int state)
    withSpiExtension = state;
 }
 
+void SetupDialog::on_checkBoxTelemetry_stateChanged(int state)
+{
+   telemetryActive = state;
+}
+
 void SetupDialog::on_spinBoxFuelPenaltyTime_valueChanged(int value)
 {
    fuelPenaltyTime = value;
@@ -73,6 +73,7 @@ class SetupDialog : public QDialog, public Ui::SetupDialog, public SlotService
       word getOutputMask();
       word getInputMask();
       byte getWithSpiExtension()    { return withSpiExtension ? yes : no; }
+      int getTelemetryActive()      { return telemetryActive; }
       int getGhostcarInvert()       { return yes; }  // todo: einstellbar
       QString getDriverImage(QString name) { return driverImages[name]; }
       QString getCarImage(QString car) { return carImages[car]; }
@@ -107,6 +108,7 @@ class SetupDialog : public QDialog, public Ui::SetupDialog, public SlotService
       int fuelingActive;
       int fuelPenaltyTime;
       byte withSpiExtension;
+      int telemetryActive;
       int animationInterval;
       int driverImageMode;
       QHash<QString, QString> driverImages;
@@ -158,6 +160,7 @@ class SetupDialog : public QDialog, public Ui::SetupDialog, public SlotService
       void inputSignalChanged(int row, int col);
       void analogInputChanged(int row, int col);
       void on_checkBoxWithSpiExtension_stateChanged(int state);
+      void on_checkBoxTelemetry_stateChanged(int state);
       void on_pushButtonRemoveDriverImage_clicked();
       void on_pushButtonRemoveCarImage_clicked();
       void on_radioButtonDriverImage_toggled(bool checked);
@@ -24,7 +24,11 @@
 SqliteDb::SqliteDb(const char* name)
 { 
    firstFetch = true;
+   current = 0;
    db = 0;
+   useCounter = 0;
+   cacheHits = 0;
+   cacheMisses = 0;
 
    dbName = (char*)malloc(strlen(name)+1);
    sprintf(dbName, "%s", name);
@@ -66,37 +70,130 @@ int SqliteDb::open()
 
 int SqliteDb::close()
 {
+   clearCache();
+
    if (db) 
       sqlite3_close(db);   
 
+   db = 0;
+
    return 0;
 }
 
 //***************************************************************************
-// Clear Results
+// Get Statement
+//  - prepared statement for 'sql' from the cache, reset with cleared
+//    bindings, don't finalize it! A statement must not be used by
+//    two callers at the same time.
 //***************************************************************************
 
-void SqliteDb::clearResults()
+SqliteDb::Statement* SqliteDb::getStatement(const char* sql)
 {
-   Result* r;
-   Field* f;
+   CachedStatement entry;
+   int lru = 0;
 
-   while ((r = getFirstResult()))
+   for (int i = 0; i < cache.getCount(); i++)
    {
-      results.remove(r);
+      CachedStatement* c = &cache[i];
 
-      while ((f = (Field*)r->fields.getFirst()))
+      if (strcmp(c->sql, sql) == 0)
       {
-         r->fields.remove(f);
-
-         free(f->name);
-         free(f->value);
+         cacheHits++;
+         c->lastUse = ++useCounter;
+         sqlite3_reset(c->stmt);
+         sqlite3_clear_bindings(c->stmt);
 
-         delete f;
+         return c->stmt;
       }
 
-      delete r;
+      if (c->lastUse < cache[lru].lastUse)
+         lru = i;
+   }
+
+   cacheMisses++;
+
+   if (prepare(sql, entry.stmt) != 0)
+   {
+      fprintf(stderr, "Error: preparing statement '%s' failed, '%s'\n",
+              sql, lastError());
+      return 0;
+   }
+
+   entry.sql = strdup(sql);
+   entry.lastUse = ++useCounter;
+
+   if (cache.getCount() < maxCachedStatements)
+   {
+      cache.append(entry);
+   }
+   else
+   {
+      finalize(cache[lru].stmt);
+      free(cache[lru].sql);
+      cache[lru] = entry;
+   }
+
+   return entry.stmt;
+}
+
+//***************************************************************************
+// Clear Cache
+//***************************************************************************
+
+void SqliteDb::clearCache()
+{
+   if (cacheHits || cacheMisses)
+      tell(eloDetail, "Statement cache: (%d) hits, (%d) misses, hit rate %.1f%%",
+           cacheHits, cacheMisses, cacheHits * 100.0 / (cacheHits + cacheMisses));
+
+   for (int i = 0; i < cache.getCount(); i++)
+   {
+      finalize(cache[i].stmt);
+      free(cache[i].sql);
    }
+
+   cache.clear();
+}
+
+//***************************************************************************
+// Clear Results
+//***************************************************************************
+
+void SqliteDb::clearResults()
+{
+   results.clear();
+   fields.clear();
+   names.clear();
+   arena.reset();
+   current = 0;
+}
+
+//***************************************************************************
+// Name Of
+//  - the column names are the same for all rows, store them once
+//***************************************************************************
+
+const char* SqliteDb::nameOf(int i, const char* name)
+{
+   if (i < names.getCount() && strcasecmp(names[i], name) == 0)
+      return names[i];
+
+   const char* p = arena.strdup(name);
+
+   if (i == names.getCount())
+      names.append(p);
+
+   return p;
+}
+
+//***************************************************************************
+// Log Allocations
+//***************************************************************************
+
+void SqliteDb::logAllocations(long before)
+{
+   tell(eloDetail, "Query got (%d) rows, (%ld) allocations",
+        getResultCount(), containerAllocations - before);
 }
 
 //***************************************************************************
@@ -105,16 +202,16 @@ void SqliteDb::clearResults()
 
 SqliteDb::Field* SqliteDb::getFieldOf(const char* name, Result* aResult)
 {
-   Field* f;
-
    if (!aResult)
       aResult = getFirstResult();
 
    if (!aResult)
       return 0;
 
-   for (f = (Field*)aResult->fields.getFirst(); f; f = (Field*)aResult->fields.getNext())
+   for (int i = 0; i < aResult->count; i++)
    {
+      Field* f = getField(aResult, i);
+
       if (strcasecmp(f->name, name) == 0)
          return f;
    }
@@ -191,23 +288,22 @@ int SqliteDb::beforeFetch()
 
 int SqliteDb::atData(int count, char** value, char** name)
 {
-   Result* r = new Result;
-   Field* f;
+   Result r;
 
-   results.append(r);
+   r.first = fields.getCount();
+   r.count = count;
 
    for (int i = 0; i < count; i++)
    {
-      f = new Field;
-      r->fields.append(f);
-
-      f->name = (char*)malloc(strlen(name[i])+1);
-      f->value = (char*)malloc(strlen(value[i] ? value[i] : "NULL") +1);
+      Field f;
 
-      sprintf(f->name, "%s", name[i]);
-      sprintf(f->value, "%s", value[i] ? value[i] : "NULL");
+      f.name = nameOf(i, name[i]);
+      f.value = arena.strdup(value[i] ? value[i] : "NULL");
+      fields.append(f);
    }
 
+   results.append(r);
+
    return 0;
 }
 
@@ -219,6 +315,7 @@ int SqliteDb::execute(const char* sql)
 {
    int status;
    char* errMsg = 0;
+   long allocations = containerAllocations;
 
    firstFetch = true;
 
@@ -234,6 +331,8 @@ int SqliteDb::execute(const char* sql)
          sqlite3_free(errMsg);
       }
    }
+   else if (!firstFetch)
+      logAllocations(allocations);
 
    return status;
 }
@@ -244,7 +343,9 @@ int SqliteDb::execute(const char* sql)
 
 int SqliteDb::prepare(const char* sql, sqlite3_stmt* &sqlStatement)
 {
-   return result(sqlite3_prepare(db, sql, strlen(sql), &sqlStatement, NULL));
+   // v2 to re-prepare cached statements after schema changes
+
+   return result(sqlite3_prepare_v2(db, sql, strlen(sql), &sqlStatement, NULL));
 }
 
 //***************************************************************************
@@ -273,8 +374,7 @@ int SqliteDb::steps(sqlite3_stmt* sqlStatement)
 {
    const char* value;
    const char* name;
-   Result* r;
-   Field* f;
+   long allocations = containerAllocations;
    int cols;
 
    clearResults();
@@ -282,28 +382,32 @@ int SqliteDb::steps(sqlite3_stmt* sqlStatement)
 
    while (sqlite3_step(sqlStatement) == SQLITE_ROW)
    {
-      r = new Result;
-      results.append(r);
-      
+      Result r;
+
+      r.first = fields.getCount();
+      r.count = 0;
+
       for (int i = 0; i < cols; i++)
-      {       
+      {
+         Field f;
+
          name = sqlite3_column_name(sqlStatement, i);
          value = (char*)sqlite3_column_text(sqlStatement, i);
 
          if (!value || !name)
             continue;
 
-         f = new Field;
-         r->fields.append(f);
-
-         f->name = (char*)malloc(strlen(name)+1);
-         f->value = (char*)malloc(strlen(value ? value : "NULL") +1);
-
-         sprintf(f->name, "%s", name);
-         sprintf(f->value, "%s", value ? value : "NULL");
+         f.name = nameOf(i, name);
+         f.value = arena.strdup(value);
+         fields.append(f);
+         r.count++;
       }
+
+      results.append(r);
    }
 
+   logAllocations(allocations);
+
    return getResultCount() ? 0 : -1;
 }
 
@@ -322,7 +426,7 @@ int SqliteDb::reset(sqlite3_stmt* sqlStatement)
 
 int SqliteDb::bindText(sqlite3_stmt* sqlStatement, int index, const char* value)
 {
-   return result(sqlite3_bind_text(sqlStatement, index, value, strlen(value), SQLITE_STATIC));
+   return result(sqlite3_bind_text(sqlStatement, index, value, strlen(value), SQLITE_TRANSIENT));
 }
 
 int SqliteDb::bindInt(sqlite3_stmt* sqlStatement, int index, int value)
@@ -330,6 +434,11 @@ int SqliteDb::bindInt(sqlite3_stmt* sqlStatement, int index, int value)
    return result(sqlite3_bind_int(sqlStatement, index, value));
 }
 
+int SqliteDb::bindInt64(sqlite3_stmt* sqlStatement, int index, long long value)
+{
+   return result(sqlite3_bind_int64(sqlStatement, index, value));
+}
+
 int SqliteDb::bindDouble(sqlite3_stmt* sqlStatement, int index, double value)
 {
    return result(sqlite3_bind_double(sqlStatement, index, value));
@@ -340,13 +449,67 @@ int SqliteDb::bindNull(sqlite3_stmt* sqlStatement, int index)
    return result(sqlite3_bind_null(sqlStatement, index));
 }
 
+int SqliteDb::bindBlob(sqlite3_stmt* sqlStatement, int index, const void* value, int size)
+{
+   return result(sqlite3_bind_blob(sqlStatement, index, value, size, SQLITE_TRANSIENT));
+}
+
+//***************************************************************************
+// Class Cursor
+//***************************************************************************
+
+SqliteDb::Cursor::Cursor(SqliteDb* aDb, const char* sql)
+{
+   db = aDb;
+   stmt = db->getStatement(sql);
+}
+
+SqliteDb::Cursor::~Cursor()
+{
+   if (stmt)
+      db->reset(stmt);       // stays in the cache
+}
+
+//***************************************************************************
+// Next
+//  - returns yes as long as a row is available
+//***************************************************************************
+
+int SqliteDb::Cursor::next()
+{
+   int status;
+
+   if (!stmt)
+      return no;
+
+   if ((status = sqlite3_step(stmt)) == SQLITE_ROW)
+      return yes;
+
+   if (status != SQLITE_DONE)
+      fprintf(stderr, "Error: step failed, '%s' (%d)\n", db->lastError(), status);
+
+   return no;
+}
+
+int SqliteDb::Cursor::reset()
+{
+   return stmt ? db->reset(stmt) : -1;
+}
+
+const char* SqliteDb::Cursor::getText(int col)
+{
+   const char* value = (const char*)sqlite3_column_text(stmt, col);
+
+   return value ? value : "";
+}
+
 //***************************************************************************
 // Last Error
 //***************************************************************************
 
 const char* SqliteDb::lastError()
 {
-   static const char* msg = sqlite3_errmsg(db);
+   const char* msg = sqlite3_errmsg(db);
 
    return msg ? msg : "";
 }
@@ -358,23 +521,22 @@ const char* SqliteDb::lastError()
 int SqliteDb::show()
 {
    Result* r;
-   Field* f;
-   
-   if ((r = (Result*)results.getFirst()))
+
+   if ((r = getFirstResult()))
    {
-      for (f = (Field*)r->fields.getFirst(); f; f = (Field*)r->fields.getNext())
-         printf("%s\t| ", f->name);
-      
+      for (int i = 0; i < r->count; i++)
+         printf("%s\t| ", getField(r, i)->name);
+
       printf("\n");
    }
-   
-   for (r = (Result*)results.getFirst(); r; r = (Result*)results.getNext())
+
+   for (r = getFirstResult(); r; r = getNextResult())
    {
-      for (f = (Field*)r->fields.getFirst(); f; f = (Field*)r->fields.getNext())
-         printf("%s\t| ", f->value);
-      
+      for (int i = 0; i < r->count; i++)
+         printf("%s\t| ", getField(r, i)->value);
+
       printf("\n");
    }
-   
+
    return 0;
 }
@@ -30,14 +30,52 @@ class SqliteDb
 
       struct Field
       {
-         char* name;
-         char* value;
+         const char* name;             // stored in 'arena'
+         const char* value;
       };
 
       struct Result
       {
-         List fields;
-         int getFieldCount()   { return fields.getCount(); }
+         int first;                    // index of first field in 'fields'
+         int count;
+         int getFieldCount()   { return count; }
+      };
+
+      //***************************************************************************
+      // Cursor
+      //  - streams the rows of a statement, the columns are read typed by
+      //    index direct from sqlite, nothing is copied
+      //  - text values are valid until the next call of next()
+      //  - the statement is taken from the statement cache of the db
+      //***************************************************************************
+
+      class Cursor
+      {
+         public:
+
+            Cursor(SqliteDb* aDb, const char* sql);
+            ~Cursor();
+
+            int isValid()                   { return stmt != 0; }
+            Statement* getStatement()       { return stmt; }
+
+            int next();
+            int reset();
+
+            int getColumnCount()            { return sqlite3_column_count(stmt); }
+            const char* getName(int col)    { return sqlite3_column_name(stmt, col); }
+            int isNull(int col)             { return sqlite3_column_type(stmt, col) == SQLITE_NULL; }
+            long long getInt64(int col)     { return sqlite3_column_int64(stmt, col); }
+            int getInt(int col)             { return sqlite3_column_int(stmt, col); }
+            double getDouble(int col)       { return sqlite3_column_double(stmt, col); }
+            const char* getText(int col);
+            const void* getBlob(int col)    { return sqlite3_column_blob(stmt, col); }
+            int getBlobSize(int col)        { return sqlite3_column_bytes(stmt, col); }
+
+         protected:
+
+            SqliteDb* db;
+            Statement* stmt;
       };
 
       SqliteDb(const char* name);
@@ -56,15 +94,22 @@ class SqliteDb
       int steps(sqlite3_stmt* sqlStatement);
       int reset(sqlite3_stmt* sqlStatement);
 
+      Statement* getStatement(const char* sql);
+      int getCacheHits()         { return cacheHits; }
+      int getCacheMisses()       { return cacheMisses; }
+
       int bindText(sqlite3_stmt* sqlStatement, int index, const char* value);
       int bindInt(sqlite3_stmt* sqlStatement, int index, int value);
+      int bindInt64(sqlite3_stmt* sqlStatement, int index, long long value);
       int bindDouble(sqlite3_stmt* sqlStatement, int index, double value);
       int bindNull(sqlite3_stmt* sqlStatement, int index);
+      int bindBlob(sqlite3_stmt* sqlStatement, int index, const void* value, int size);
 
       void clearResults();
-      Result* getFirstResult()   { return (Result*)results.getFirst(); }
-      Result* getNextResult()    { return (Result*)results.getNext(); }
+      Result* getFirstResult()   { current = 0; return results.getAt(current); }
+      Result* getNextResult()    { return results.getAt(++current); }
       int getResultCount()       { return results.getCount(); }
+      Field* getField(Result* aResult, int i)  { return &fields[aResult->first + i]; }
 
       Field* getFieldOf(const char* name, Result* aResult = 0);
       const char* getValueOf(const char* name, Result* aResult = 0);
@@ -79,13 +124,43 @@ class SqliteDb
 
    protected:
 
+      enum Misc
+      {
+         maxCachedStatements = 32
+      };
+
+      struct CachedStatement
+      {
+         char* sql;
+         Statement* stmt;
+         unsigned long lastUse;
+      };
+
       int result(int status);
+      void clearCache();
       static int fetch(void* obj, int count, char** value, char** name);
+      const char* nameOf(int i, const char* name);
+      void logAllocations(long before);
 
       // data
 
       int firstFetch;
-      List results;
+
+      // results, released at once by clearResults()
+
+      Array<Result> results;
+      Array<Field> fields;
+      Array<const char*> names;     // column names, stored once per query
+      Arena arena;
+      int current;
+
+      // prepared statements, least recently used is dropped
+
+      Array<CachedStatement> cache;
+      unsigned long useCounter;
+      int cacheHits;
+      int cacheMisses;
+
       char* dbName;
       sqlite3* db;
 };
@@ -0,0 +1,180 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File statistics.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <math.h>
+
+#include <common.hpp>
+#include <statistics.hpp>
+
+//***************************************************************************
+// Object
+//***************************************************************************
+
+Statistics::Statistics()
+{
+   lastLapId = na;
+}
+
+//***************************************************************************
+// Update
+//  - take the result of a job, returns yes if the entries changed
+//***************************************************************************
+
+int Statistics::update(Job* job)
+{
+   if (job->getStatus() != success || job->unchanged)
+      return no;
+
+   lastLapId = job->lastLapId;
+   entries = job->entries;
+
+   return yes;
+}
+
+//***************************************************************************
+// Class LapStatistics
+//***************************************************************************
+
+void LapStatistics::reset()
+{
+   count = 0;
+   last = 0;
+   best = 0;
+   mean = 0;
+   m2 = 0;
+   windowSum = 0;
+   next = 0;
+}
+
+//***************************************************************************
+// Add
+//***************************************************************************
+
+void LapStatistics::add(long long usec)
+{
+   double delta = usec - mean;
+
+   count++;
+   mean += delta / count;
+   m2 += delta * (usec - mean);
+
+   last = usec;
+
+   if (!best || usec < best)
+      best = usec;
+
+   // rolling window, the oldest lap drops out
+
+   if (count > windowSize)
+      windowSum -= window[next];
+
+   window[next] = usec;
+   windowSum += usec;
+   next = (next + 1) % windowSize;
+}
+
+double LapStatistics::getDeviation() const
+{
+   return count > 1 ? sqrt(m2 / (count - 1)) : 0;
+}
+
+double LapStatistics::getWindowMean() const
+{
+   return count ? windowSum / (double)getWindowCount() : 0;
+}
+
+//***************************************************************************
+// Job Execute
+//***************************************************************************
+
+int Statistics::Job::execute(SqliteDb* db)
+{
+   long long lapId = 0;
+
+   // the rowid max is a lookup, no scan
+
+   {
+      SqliteDb::Cursor cursor(db, "SELECT ifnull(max(LAP_ID), 0) FROM laps;");
+
+      if (cursor.next())
+         lapId = cursor.getInt64(0);
+   }
+
+   if (lapId == lastLapId)
+   {
+      unchanged = yes;
+      return success;
+   }
+
+   lastLapId = lapId;
+
+   // rank of the lap time and index of the race per key,
+   // the sums of the regression (race index -> lap time) are built in sql
+
+   SqliteDb::Cursor cursor(db,
+      "WITH ranked AS ("
+      "SELECT DRIVER_ID, CAR, COURSE, LAP_LENGTH, LAP_TIME, RACE_ID, "
+      "ROW_NUMBER() OVER (PARTITION BY DRIVER_ID, CAR, COURSE, LAP_LENGTH ORDER BY LAP_TIME) AS RN, "
+      "COUNT(*) OVER (PARTITION BY DRIVER_ID, CAR, COURSE, LAP_LENGTH) AS N, "
+      "DENSE_RANK() OVER (PARTITION BY DRIVER_ID, CAR, COURSE, LAP_LENGTH ORDER BY RACE_ID) AS X "
+      "FROM record_laps) "
+      "SELECT d.NAME, k.CAR, k.COURSE, k.LAP_LENGTH, "
+      "count(*), max(X), min(LAP_TIME), avg(LAP_TIME), sum(LAP_TIME * 1.0 * LAP_TIME), "
+      "min(CASE WHEN RN = (N + 1) / 2 THEN LAP_TIME END), "
+      "min(CASE WHEN RN = (9 * N + 9) / 10 THEN LAP_TIME END), "
+      "sum(X * 1.0), sum(X * 1.0 * X), sum(X * 1.0 * LAP_TIME), sum(LAP_TIME * 1.0) "
+      "FROM ranked AS k LEFT JOIN drivers AS d ON d.DRIVER_ID = k.DRIVER_ID "
+      "GROUP BY k.DRIVER_ID, k.CAR, k.COURSE, k.LAP_LENGTH "
+      "ORDER BY k.COURSE, k.LAP_LENGTH, min(LAP_TIME);");
+
+   if (!cursor.isValid())
+      return fail;
+
+   while (cursor.next())
+   {
+      Entry e;
+
+      e.driver = cursor.getText(0);
+      e.car = cursor.getText(1);
+      e.course = cursor.getText(2);
+      e.lapLength = cursor.getDouble(3);
+      e.laps = cursor.getInt(4);
+      e.races = cursor.getInt(5);
+      e.best = cursor.getInt64(6);
+      e.mean = cursor.getDouble(7);
+      e.median = cursor.getInt64(9);
+      e.p90 = cursor.getInt64(10);
+
+      double n = e.laps;
+
+      // sample variance like LapStatistics, 0 for a single lap
+
+      double variance = n > 1 ? (cursor.getDouble(8) - n * e.mean * e.mean) / (n - 1) : 0;
+
+      e.deviation = variance > 0 ? sqrt(variance) : 0;
+      e.consistency = e.mean > 0 ? qMax(0.0, 100.0 * (1.0 - e.deviation / e.mean)) : 0;
+
+      // least squares slope, 0 until there are two races
+
+      double sx = cursor.getDouble(11);
+      double sxx = cursor.getDouble(12);
+      double sxy = cursor.getDouble(13);
+      double sy = cursor.getDouble(14);
+      double divisor = n * sxx - sx * sx;
+
+      e.trend = e.races > 1 && divisor != 0 ? (n * sxy - sx * sy) / divisor : 0;
+
+      entries.append(e);
+   }
+
+   return success;
+}
@@ -0,0 +1,132 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File statistics.hpp
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+#ifndef _STATISTICS_H_
+#define _STATISTICS_H_
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <QList>
+#include <QString>
+
+#include <dbservice.hpp>
+
+//***************************************************************************
+// Class Statistics
+//  - lap time aggregates per driver, car, course and lap length
+//  - ranks and percentiles are computed by window functions (sqlite >= 3.25)
+//  - the result is cached with the last lap id, it's computed again only
+//    if laps are added or removed
+//***************************************************************************
+
+class Statistics
+{
+   public:
+
+      struct Entry
+      {
+         QString driver;
+         QString car;
+         QString course;
+         double lapLength;
+
+         int laps;
+         int races;
+         long long best;           // [us]
+         double mean;              // [us]
+         long long median;         // [us] lower median
+         long long p90;            // [us] 90% of the laps are faster or equal
+         double deviation;         // [us] standard deviation
+         double consistency;       // [%] 100 - coefficient of variation
+         double trend;             // [us/race] slope of the lap time over the races
+      };
+
+      //***************************************************************************
+      // Job
+      //  - computes the entries in the db service thread, does nothing
+      //    if the last lap id is still the one of the cache
+      //***************************************************************************
+
+      class Job : public DbJob
+      {
+         public:
+
+            Job(long long aLastLapId)  { lastLapId = aLastLapId; unchanged = no; }
+
+            int execute(SqliteDb* db);
+
+            long long lastLapId;
+            int unchanged;
+            QList<Entry> entries;
+      };
+
+      // object
+
+      Statistics();
+
+      // interface
+
+      Job* createJob()                  { return new Job(lastLapId); }
+      int update(Job* job);
+
+      int getCount()                    { return entries.size(); }
+      const Entry& at(int i)            { return entries.at(i); }
+
+   protected:
+
+      long long lastLapId;              // key of the cached entries, -1 if none
+      QList<Entry> entries;
+};
+
+//***************************************************************************
+// Class LapStatistics
+//  - streaming statistics of the laps of one slot while the race is running
+//  - add() is O(1), mean and deviation by Welford's algorithm (no sum of
+//    squares, stable for long races), the rolling mean over the last
+//    'windowSize' laps by a ring buffer with a running integer sum
+//***************************************************************************
+
+class LapStatistics
+{
+   public:
+
+      enum Misc
+      {
+         windowSize = 5
+      };
+
+      LapStatistics()                   { reset(); }
+
+      void reset();
+      void add(long long usec);
+
+      int getCount() const              { return count; }
+      long long getLast() const         { return last; }           // [us]
+      long long getBest() const         { return best; }           // [us]
+      double getMean() const            { return mean; }           // [us]
+      double getDeviation() const;                                 // [us]
+      double getWindowMean() const;                                // [us]
+      int getWindowCount() const        { return qMin(count, (int)windowSize); }
+
+   protected:
+
+      int count;
+      long long last;
+      long long best;
+      double mean;
+      double m2;                        // sum of squared differences to the mean
+
+      long long window[windowSize];
+      long long windowSum;
+      int next;                         // ring buffer position of the next lap
+};
+
+//***************************************************************************
+#endif // _STATISTICS_H_
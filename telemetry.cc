@@ -0,0 +1,294 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File telemetry.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <QPainter>
+#include <QPen>
+
+#include <common.hpp>
+#include <telemetry.hpp>
+
+//***************************************************************************
+// Object
+//***************************************************************************
+
+TelemetryChart::TelemetryChart(QWidget* parent)
+   : QWidget(parent)
+{
+   setBackgroundRole(QPalette::Base);
+   setAutoFillBackground(true);
+   setMinimumSize(300, 150);
+
+   msPerPixel = 20;
+   laneCount = 1;
+   fullRedraw = yes;
+   canvasTime = 0;
+
+   timer = new QTimer(this);
+   connect(timer, SIGNAL(timeout()), this, SLOT(onRefresh()));
+
+   clear();
+}
+
+//***************************************************************************
+// Series
+//***************************************************************************
+
+int TelemetryChart::addSeries(const QString& name, const QColor& color, int lane,
+                              int min, int max, Qt::PenStyle style)
+{
+   Series s;
+
+   s.name = name;
+   s.color = color;
+   s.style = style;
+   s.lane = lane;
+   s.min = min;
+   s.max = max > min ? max : min + 1;
+   s.ring.resize(capacity);
+   s.total = 0;
+   s.drawn = 0;
+
+   series.append(s);
+   laneCount = qMax(laneCount, lane+1);
+   fullRedraw = yes;
+
+   return series.size() - 1;
+}
+
+void TelemetryChart::setRange(int index, int min, int max)
+{
+   if (index < 0 || index >= series.size())
+      return ;
+
+   series[index].min = min;
+   series[index].max = max > min ? max : min + 1;
+   fullRedraw = yes;
+}
+
+//***************************************************************************
+// Append
+//  - called for every value of the io thread, nothing is painted here
+//***************************************************************************
+
+void TelemetryChart::append(int index, int value)
+{
+   if (index < 0 || index >= series.size())
+      return ;
+
+   Series* s = &series[index];
+   Sample* sample = &s->ring[s->total % capacity];
+
+   sample->time = now();
+   sample->value = value;
+   s->total++;
+}
+
+void TelemetryChart::clear()
+{
+   SlotService::tvNow(&start);
+
+   for (int i = 0; i < series.size(); i++)
+      series[i].total = series[i].drawn = 0;
+
+   canvasTime = 0;
+   fullRedraw = yes;
+}
+
+long long TelemetryChart::now()
+{
+   timeval tv;
+
+   return SlotService::elapsed(&start, SlotService::tvNow(&tv)) / 1000;
+}
+
+//***************************************************************************
+// Coordinates
+//***************************************************************************
+
+int TelemetryChart::xOf(long long time)
+{
+   return canvas.width() - 1 - (int)((canvasTime - time) / msPerPixel);
+}
+
+int TelemetryChart::yOf(const Series* s, int value)
+{
+   int laneHeight = canvas.height() / laneCount;
+   int top = s->lane * laneHeight + laneGap;
+   int height = laneHeight - 2 * laneGap;
+
+   value = qMax(s->min, qMin(value, s->max));
+
+   return top + height - (value - s->min) * height / (s->max - s->min);
+}
+
+//***************************************************************************
+// Show / Hide
+//  - the timer runs only while the chart is visible
+//***************************************************************************
+
+void TelemetryChart::showEvent(QShowEvent*)
+{
+   fullRedraw = yes;
+   timer->start(refreshInterval);
+}
+
+void TelemetryChart::hideEvent(QHideEvent*)
+{
+   timer->stop();
+}
+
+void TelemetryChart::resizeEvent(QResizeEvent*)
+{
+   fullRedraw = yes;
+}
+
+//***************************************************************************
+// On Refresh
+//  - scroll the canvas by the elapsed time, draw the new samples
+//***************************************************************************
+
+void TelemetryChart::onRefresh()
+{
+   if (fullRedraw || canvas.size() != size())
+   {
+      redraw();
+      update();
+      return ;
+   }
+
+   int dx = (int)((now() - canvasTime) / msPerPixel);
+   int pending = no;
+
+   for (int i = 0; i < series.size() && !pending; i++)
+      pending = series.at(i).drawn < series.at(i).total;
+
+   if (!dx && !pending)
+      return ;
+
+   if (dx >= canvas.width())
+   {
+      redraw();
+      update();
+      return ;
+   }
+
+   // scroll (not while a painter is active), the exposed stripe at the right is cleared
+
+   if (dx)
+   {
+      canvas.scroll(-dx, 0, canvas.rect());
+      canvasTime += (long long)dx * msPerPixel;
+   }
+
+   QPainter painter(&canvas);
+
+   if (dx)
+   {
+      painter.fillRect(canvas.width() - dx, 0, dx, canvas.height(), palette().base());
+      painter.setPen(palette().mid().color());
+
+      for (int lane = 1; lane < laneCount; lane++)
+         painter.drawLine(canvas.width() - dx, lane * canvas.height() / laneCount,
+                          canvas.width(), lane * canvas.height() / laneCount);
+   }
+
+   for (int i = 0; i < series.size(); i++)
+      drawSeries(&painter, &series[i], series.at(i).drawn - 1);
+
+   update();
+}
+
+//***************************************************************************
+// Redraw
+//  - the whole canvas from the ring buffers (resize, range change)
+//***************************************************************************
+
+void TelemetryChart::redraw()
+{
+   if (canvas.size() != size())
+      canvas = QPixmap(size());
+
+   fullRedraw = no;
+   canvasTime = now();
+   canvas.fill(palette().base().color());
+
+   QPainter painter(&canvas);
+
+   // lanes
+
+   painter.setPen(palette().mid().color());
+
+   for (int lane = 1; lane < laneCount; lane++)
+      painter.drawLine(0, lane * canvas.height() / laneCount,
+                       canvas.width(), lane * canvas.height() / laneCount);
+
+   for (int i = 0; i < series.size(); i++)
+      drawSeries(&painter, &series[i], 0);
+}
+
+//***************************************************************************
+// Draw Series
+//  - the segments from sample 'from' on, older ones are gone from the ring
+//***************************************************************************
+
+void TelemetryChart::drawSeries(QPainter* painter, Series* s, long from)
+{
+   QPen pen(s->color);
+   QPolygon polygon;
+
+   from = qMax(from, qMax(0L, s->total - (long)capacity));
+
+   for (long i = from; i < s->total; i++)
+   {
+      const Sample& sample = s->ring.at(i % capacity);
+      int x = xOf(sample.time);
+
+      if (x < 0 && i+1 < s->total && xOf(s->ring.at((i+1) % capacity).time) < 0)
+         continue;                   // left of the canvas
+
+      polygon << QPoint(x, yOf(s, sample.value));
+   }
+
+   s->drawn = s->total;
+
+   if (polygon.size() < 2)
+      return ;
+
+   pen.setStyle(s->style);
+   painter->setPen(pen);
+   painter->drawPolyline(polygon);
+}
+
+//***************************************************************************
+// Paint Event
+//  - the canvas and the names of the series
+//***************************************************************************
+
+void TelemetryChart::paintEvent(QPaintEvent*)
+{
+   QPainter painter(this);
+   QVector<int> line(laneCount, 0);
+
+   painter.drawPixmap(0, 0, canvas);
+
+   for (int i = 0; i < series.size(); i++)
+   {
+      const Series& s = series.at(i);
+      int lane = qMin(s.lane, laneCount-1);
+
+      painter.setPen(s.color);
+      painter.drawText(5, lane * height() / laneCount + 15 + 15 * line[lane]++, s.name);
+   }
+
+   painter.setPen(palette().dark().color());
+   painter.drawRect(QRect(0, 0, width() - 1, height() - 1));
+}
@@ -0,0 +1,108 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File telemetry.hpp
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <sys/time.h>
+
+#include <QWidget>
+#include <QPixmap>
+#include <QTimer>
+#include <QVector>
+#include <QColor>
+
+//***************************************************************************
+// Class TelemetryChart
+//  - live chart of several series, each in a fixed size ring buffer
+//  - append() only stores the value, the chart is drawn by a timer
+//    (at most 'refreshInterval'), the canvas is scrolled by the elapsed
+//    time and only the new segments are drawn
+//  - the series are shown in lanes one above the other, the x axis is
+//    the time since clear()
+//***************************************************************************
+
+class TelemetryChart : public QWidget
+{
+      Q_OBJECT
+
+   public:
+
+      enum Misc
+      {
+         capacity = 4096,            // samples per series
+         refreshInterval = 40,       // [ms] 25 redraws per second at most
+         laneGap = 4
+      };
+
+      TelemetryChart(QWidget* parent = 0);
+
+      int addSeries(const QString& name, const QColor& color, int lane,
+                    int min, int max, Qt::PenStyle style = Qt::SolidLine);
+      void setRange(int series, int min, int max);
+      void append(int series, int value);
+      void clear();
+
+      void setMsPerPixel(int ms)     { msPerPixel = qMax(ms, 1); fullRedraw = yes; }
+      void setLaneCount(int count)   { laneCount = qMax(count, 1); fullRedraw = yes; }
+
+   protected:
+
+      struct Sample
+      {
+         long long time;             // [ms] since clear()
+         int value;
+      };
+
+      struct Series
+      {
+         QString name;
+         QColor color;
+         Qt::PenStyle style;
+         int lane;
+         int min;
+         int max;
+
+         QVector<Sample> ring;
+         long total;                 // samples appended, ring index is total % capacity
+         long drawn;                 // samples on the canvas
+      };
+
+      void paintEvent(QPaintEvent* event);
+      void resizeEvent(QResizeEvent* event);
+      void showEvent(QShowEvent* event);
+      void hideEvent(QHideEvent* event);
+
+      void redraw();
+      void drawSeries(QPainter* painter, Series* s, long from);
+      int xOf(long long time);
+      int yOf(const Series* s, int value);
+      long long now();
+
+      // data
+
+      QVector<Series> series;
+      QPixmap canvas;
+      QTimer* timer;
+      timeval start;
+      long long canvasTime;          // [ms] time at the right edge of the canvas
+      int msPerPixel;
+      int laneCount;
+      int fullRedraw;
+
+   private slots:
+
+      void onRefresh();
+};
+
+//***************************************************************************
+#endif // _TELEMETRY_H_
@@ -0,0 +1,404 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File trace.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#endif
+
+#include <common.hpp>
+#include <trace.hpp>
+
+//***************************************************************************
+// Globals
+//***************************************************************************
+
+Trace::Header* Trace::header = 0;
+Trace::Format* Trace::formats = 0;
+Trace::Record* Trace::records = 0;
+size_t Trace::mapSize = 0;
+
+static uint32_t nextRecord = 0;
+static uint32_t nextFormat = 0;
+
+//***************************************************************************
+// Open
+//***************************************************************************
+
+int Trace::open(const char* file, int recordCount)
+{
+#ifdef _WIN32
+   return fail;
+#else
+   int fd;
+   void* map;
+   timeval tp;
+
+   if (records)
+      return done;
+
+   mapSize = sizeof(Header) + maxFormats * sizeof(Format) + recordCount * sizeof(Record);
+
+   if ((fd = ::open(file, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+      return fail;
+
+   if (ftruncate(fd, mapSize) < 0)
+   {
+      ::close(fd);
+      return fail;
+   }
+
+   map = mmap(0, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   ::close(fd);
+
+   if (map == MAP_FAILED)
+      return fail;
+
+   // the new file is zero filled, so all records and formats are unused
+
+   header = (Header*)map;
+   formats = (Format*)((char*)map + sizeof(Header));
+
+   strcpy(header->magic, "LSTRACE");
+   header->version = version;
+   header->recordCount = recordCount;
+   header->maxFormats = maxFormats;
+   header->recordSize = sizeof(Record);
+
+   gettimeofday(&tp, 0);
+   header->startNsec = monotonic();
+   header->startSec = tp.tv_sec;
+   header->startUsec = tp.tv_usec;
+
+   nextRecord = 0;
+   nextFormat = 0;
+
+   records = (Record*)((char*)formats + maxFormats * sizeof(Format));
+
+   return success;
+#endif
+}
+
+//***************************************************************************
+// Close
+//***************************************************************************
+
+void Trace::close()
+{
+#ifndef _WIN32
+   void* map = header;
+
+   if (!records)
+      return ;
+
+   records = 0;
+   formats = 0;
+   header = 0;
+
+   msync(map, mapSize, MS_ASYNC);
+   munmap(map, mapSize);
+#endif
+}
+
+//***************************************************************************
+// Register Format
+//  - once per call site, the argument types are parsed here
+//    so write() don't have to look at the format
+//***************************************************************************
+
+int Trace::registerFormat(const char* format)
+{
+#ifdef _WIN32
+   return na;
+#else
+   uint32_t id = __sync_fetch_and_add(&nextFormat, 1);
+   Format* f;
+
+   if (!formats || id >= maxFormats)
+      return na;
+
+   f = &formats[id];
+   f->argc = parseFormat(format, f->types);
+   strncpy(f->format, format, sizeFormat);
+   f->format[sizeFormat-1] = 0;
+
+   return id;
+#endif
+}
+
+//***************************************************************************
+// Write
+//***************************************************************************
+
+void Trace::write(int formatId, int elo, ...)
+{
+#ifndef _WIN32
+   Record* r;
+   uint32_t pos;
+   va_list ap;
+
+   if (!records || formatId < 0)
+      return ;
+
+   pos = __sync_fetch_and_add(&nextRecord, 1);
+   r = &records[pos % header->recordCount];
+
+   r->sequence = 0;              // invalid while writing
+   r->nsec = monotonic();
+   r->formatId = formatId;
+   r->eloquence = elo;
+
+   va_start(ap, elo);
+   r->slotCount = pack(&formats[formatId], r, ap);
+   va_end(ap);
+
+   __sync_synchronize();
+   r->sequence = pos + 1;
+#endif
+}
+
+//***************************************************************************
+// Pack
+//  - copy the arguments to the record slots, returns the used slot count
+//***************************************************************************
+
+int Trace::pack(const Format* f, Record* r, va_list ap)
+{
+   int slot = 0;
+
+   for (int i = 0; i < f->argc && slot < maxArgs; i++)
+   {
+      switch (f->types[i])
+      {
+         case atInt:      r->args[slot++] = (int64_t)va_arg(ap, int);                break;
+         case atBinary:   r->args[slot++] = va_arg(ap, unsigned int);                break;
+         case atLong:     r->args[slot++] = (int64_t)va_arg(ap, long);               break;
+         case atLongLong: r->args[slot++] = (int64_t)va_arg(ap, long long);          break;
+         case atPointer:  r->args[slot++] = (uint64_t)(size_t)va_arg(ap, void*);     break;
+
+         case atDouble:
+         {
+            double d = va_arg(ap, double);
+            memcpy(&r->args[slot++], &d, sizeof(double));
+            break;
+         }
+
+         case atString:
+         {
+            const char* s = va_arg(ap, const char*);
+            char* p = (char*)&r->args[slot];
+            int size = (maxArgs - slot) * sizeof(uint64_t);
+            int len;
+
+            if (!s)
+               s = "";
+
+            len = qMin((int)strlen(s), size-1);
+
+            memcpy(p, s, len);
+            p[len] = 0;
+            slot += (len + sizeof(uint64_t)) / sizeof(uint64_t);
+            break;
+         }
+      }
+   }
+
+   return slot;
+}
+
+//***************************************************************************
+// Parse Format
+//  - fill the argument types of the conversions, returns the count
+//***************************************************************************
+
+int Trace::parseFormat(const char* format, uint8_t* types)
+{
+   int argc = 0;
+   const char* p = format;
+
+   while ((p = strchr(p, '%')) && argc < maxArgs)
+   {
+      int longs = 0;
+
+      p++;
+
+      if (*p == '%')
+      {
+         p++;
+         continue;
+      }
+
+      p += strspn(p, "-+ #0123456789.");
+
+      while (*p == 'l' || *p == 'h')
+      {
+         if (*p == 'l')
+            longs++;
+
+         p++;
+      }
+
+      switch (*p)
+      {
+         case 'd': case 'i': case 'u':
+         case 'x': case 'X': case 'o': case 'c':
+            types[argc++] = longs > 1 ? atLongLong : longs ? atLong : atInt;
+            break;
+
+         case 'f': case 'e': case 'E': case 'g': case 'G':
+            types[argc++] = atDouble;
+            break;
+
+         case 's': types[argc++] = atString;  break;
+         case 'p': types[argc++] = atPointer; break;
+         case 'b': types[argc++] = atBinary;  break;
+
+         default: continue;       // unknown conversion, ignore
+      }
+
+      p++;
+   }
+
+   return argc;
+}
+
+//***************************************************************************
+// Render
+//  - print record as text like printf would have done
+//***************************************************************************
+
+int Trace::render(const Format* format, const Record* record, char* buf, int size)
+{
+   const char* p = format->format;
+   int len = 0;
+   int slot = 0;
+   int arg = 0;
+
+   *buf = 0;
+
+   while (*p && len < size - 1)
+   {
+      char spec[50+TB];
+      const char* start = p;
+      int n;
+
+      if (*p != '%')
+      {
+         buf[len++] = *p++;
+         buf[len] = 0;
+         continue;
+      }
+
+      if (p[1] == '%')
+      {
+         buf[len++] = '%';
+         buf[len] = 0;
+         p += 2;
+         continue;
+      }
+
+      p++;
+      p += strspn(p, "-+ #0123456789.lh");
+
+      if (!*p)
+         break;
+
+      n = qMin((int)(p - start + 1), 50);
+      strncpy(spec, start, n);
+      spec[n] = 0;
+      p++;
+
+      if (arg >= format->argc || slot >= record->slotCount)
+      {
+         len += snprintf(buf+len, size-len, "<?>");
+         continue;
+      }
+
+      const uint64_t value = record->args[slot];
+
+      switch (format->types[arg++])
+      {
+         case atInt:      len += snprintf(buf+len, size-len, spec, (int)value);               slot++; break;
+         case atLong:     len += snprintf(buf+len, size-len, spec, (long)value);              slot++; break;
+         case atLongLong: len += snprintf(buf+len, size-len, spec, (long long)value);         slot++; break;
+         case atPointer:  len += snprintf(buf+len, size-len, spec, (void*)(size_t)value);     slot++; break;
+
+         case atDouble:
+         {
+            double d;
+            memcpy(&d, &record->args[slot++], sizeof(double));
+            len += snprintf(buf+len, size-len, spec, d);
+            break;
+         }
+
+         case atString:
+         {
+            const char* s = (const char*)&record->args[slot];
+            len += snprintf(buf+len, size-len, spec, s);
+            slot += (strlen(s) + sizeof(uint64_t)) / sizeof(uint64_t);
+            break;
+         }
+
+         case atBinary:
+         {
+            int bits = atoi(spec+1);
+
+            if (bits <= 0 || bits > 32)
+               bits = 32;
+
+            // same as SlotService::toBinStr(), grouped by bytes
+
+            for (int b = bits-1; b >= 0 && len < size-2; b--)
+            {
+               buf[len++] = (value & (1u << b)) ? '1' : '0';
+
+               if (b && !(b % 8))
+                  buf[len++] = ':';
+            }
+
+            buf[len] = 0;
+            slot++;
+            break;
+         }
+      }
+
+      len = qMin(len, size - 1);
+   }
+
+   return len;
+}
+
+//***************************************************************************
+// Monotonic
+//***************************************************************************
+
+uint64_t Trace::monotonic()
+{
+#ifdef _WIN32
+   return 0;
+#else
+   timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+//***************************************************************************
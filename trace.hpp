@@ -0,0 +1,138 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File trace.hpp
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+//***************************************************************************
+// Trace Macro
+//  - the format is registered once per call site, only its id and the raw
+//    arguments are recorded, the text is rendered offline by 'tracedump'
+//  - beside the printf conversions '%b' renders a value binary,
+//    the width gives the number of bits ('%16b')
+//  - without open trace file the message is rendered at once by tellTrace()
+//***************************************************************************
+
+#define TRACE(elo, format, ...)                                           \
+   do                                                                     \
+   {                                                                      \
+      if (Trace::isActive(elo))                                           \
+      {                                                                   \
+         static int traceFormatId = Trace::registerFormat(format);        \
+         Trace::write(traceFormatId, elo, ##__VA_ARGS__);                 \
+      }                                                                   \
+      else if (elo <= theEloquence)                                       \
+      {                                                                   \
+         tellTrace(elo, format, ##__VA_ARGS__);                           \
+      }                                                                   \
+   } while (0)
+
+extern int theEloquence;
+
+int tellTrace(int eloquence, const char* format, ...);
+
+//***************************************************************************
+// Class Trace
+//  - file layout: Header | Format[maxFormats] | Record[recordCount],
+//    the records are written as ring, 'sequence' gives the order
+//***************************************************************************
+
+class Trace
+{
+   public:
+
+      enum Misc
+      {
+         version = 1,
+         maxArgs = 6,
+         maxFormats = 256,
+         sizeFormat = 120,
+         defaultRecords = 65536       // 4 MB
+      };
+
+      enum ArgType
+      {
+         atNone,
+         atInt,
+         atLong,
+         atLongLong,
+         atDouble,
+         atString,                    // copied inline, uses the following slots
+         atPointer,
+         atBinary
+      };
+
+#pragma pack(1)
+
+      struct Header
+      {
+         char magic[8];               // "LSTRACE"
+         uint32_t version;
+         uint32_t recordCount;
+         uint32_t maxFormats;
+         uint32_t recordSize;
+         int64_t startSec;            // wall clock at open ..
+         int64_t startUsec;
+         uint64_t startNsec;          // .. and the monotonic clock at the same time
+         uint8_t reserved[16];
+      };
+
+      struct Format
+      {
+         uint8_t types[maxArgs];
+         uint8_t argc;
+         uint8_t reserved;
+         char format[sizeFormat];
+      };
+
+      struct Record                   // 64 byte
+      {
+         uint64_t nsec;               // monotonic clock
+         uint32_t sequence;           // 0 for unused
+         uint16_t formatId;
+         uint8_t eloquence;
+         uint8_t slotCount;           // used argument slots
+         uint64_t args[maxArgs];
+      };
+
+#pragma pack()
+
+      // interface
+
+      static int open(const char* file, int records = defaultRecords);
+      static void close();
+      static int isActive(int elo)   { return records && elo <= theEloquence; }
+
+      static int registerFormat(const char* format);
+      static void write(int formatId, int elo, ...);
+
+      // helper, also used by the decoder
+
+      static int parseFormat(const char* format, uint8_t* types);
+      static int pack(const Format* format, Record* record, va_list ap);
+      static int render(const Format* format, const Record* record, char* buf, int size);
+      static uint64_t monotonic();
+
+   protected:
+
+      static Header* header;
+      static Format* formats;
+      static Record* records;
+      static size_t mapSize;
+};
+
+//***************************************************************************
+#endif // _TRACE_H_
@@ -0,0 +1,138 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File tracedump.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// HOWTO build
+//***************************************************************************
+
+// g++ -ggdb -I. -I/usr/include/qt4 -I/usr/include/qt4/QtCore tracedump.cc trace.cc -o tracedump
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include <algorithm>
+
+#include <common.hpp>
+#include <trace.hpp>
+
+//***************************************************************************
+// Sort By Sequence
+//***************************************************************************
+
+static const Trace::Record* theRecords = 0;
+
+static bool bySequence(unsigned int a, unsigned int b)
+{
+   return theRecords[a].sequence < theRecords[b].sequence;
+}
+
+//***************************************************************************
+// Main
+//***************************************************************************
+
+int main(int argc, char** argv)
+{
+   const Trace::Header* header;
+   const Trace::Format* formats;
+   unsigned int* order;
+   unsigned int count = 0;
+   int eloquence = eloDebug3;
+   struct stat st;
+   void* map;
+   int fd;
+
+   if (argc < 2)
+   {
+      printf("Usage: tracedump <file> [eloquence]\n");
+      return 1;
+   }
+
+   if (argc > 2)
+      eloquence = atoi(argv[2]);
+
+   if ((fd = open(argv[1], O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+   {
+      printf("Can't open '%s', %s\n", argv[1], strerror(errno));
+      return 1;
+   }
+
+   map = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+
+   if (map == MAP_FAILED || (size_t)st.st_size < sizeof(Trace::Header))
+   {
+      printf("Can't map '%s'\n", argv[1]);
+      return 1;
+   }
+
+   header = (const Trace::Header*)map;
+
+   if (strcmp(header->magic, "LSTRACE") != 0 || header->version != Trace::version
+       || header->recordSize != sizeof(Trace::Record)
+       || sizeof(Trace::Header) + header->maxFormats * sizeof(Trace::Format)
+          + header->recordCount * sizeof(Trace::Record) > (size_t)st.st_size)
+   {
+      printf("'%s' is not a trace file of this version\n", argv[1]);
+      return 1;
+   }
+
+   formats = (const Trace::Format*)((const char*)map + sizeof(Trace::Header));
+   theRecords = (const Trace::Record*)(formats + header->maxFormats);
+
+   // collect the used records in order of writing
+
+   order = new unsigned int[header->recordCount];
+
+   for (unsigned int i = 0; i < header->recordCount; i++)
+      if (theRecords[i].sequence && theRecords[i].formatId < header->maxFormats)
+         order[count++] = i;
+
+   std::sort(order, order + count, bySequence);
+
+   for (unsigned int i = 0; i < count; i++)
+   {
+      const Trace::Record* r = &theRecords[order[i]];
+      char line[1000+TB];
+      char date[50+TB];
+      struct tm tm;
+
+      if (r->eloquence > eloquence)
+         continue;
+
+      // monotonic to wall clock by the reference taken at open
+
+      long long usec = header->startUsec + ((long long)(r->nsec - header->startNsec)) / 1000;
+      time_t sec = header->startSec + usec / 1000000;
+      usec %= 1000000;
+
+      localtime_r(&sec, &tm);
+      strftime(date, 50, "%y.%m.%d %H:%M:%S", &tm);
+
+      Trace::render(&formats[r->formatId], r, line, 1000);
+      printf("%s,%6.6lld [%d] %s\n", date, usec, r->eloquence, line);
+   }
+
+   printf("%u records\n", count);
+
+   delete[] order;
+   munmap(map, st.st_size);
+
+   return 0;
+}
@@ -0,0 +1,280 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File tsbench.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// HOWTO build
+//***************************************************************************
+
+// g++ -O2 -I. -I/usr/include/qt4 -I/usr/include/qt4/QtCore tsbench.cc tsstore.cc -lQtCore -lsqlite3 -o tsbench
+
+//***************************************************************************
+// Benchmark
+//  - writes the same synthetic race telemetry (volt and ampere of two
+//    slots, one sample every 20ms) to a table of the layout of
+//    'lap_profiles' (one row per sample) and to the time series store,
+//    then compares the size, a full scan and the lookup of one lap
+//***************************************************************************
+
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <math.h>
+
+#include <sqlite3.h>
+
+#include <common.hpp>
+#include <tsstore.hpp>
+
+//***************************************************************************
+// Tell
+//  - the tool links without common.cc (and its gui)
+//***************************************************************************
+
+int tell(int eloquence, const char* format, ...)
+{
+   va_list ap;
+
+   if (eloquence > eloAlways)
+      return success;
+
+   va_start(ap, format);
+   vfprintf(stderr, format, ap);
+   fprintf(stderr, "\n");
+   va_end(ap);
+
+   return success;
+}
+
+//***************************************************************************
+// Helper
+//***************************************************************************
+
+static double msNow()
+{
+   timeval tp;
+
+   gettimeofday(&tp, 0);
+
+   return tp.tv_sec * 1000.0 + tp.tv_usec / 1000.0;
+}
+
+static long fileSize(const char* path)
+{
+   struct stat st;
+
+   return stat(path, &st) == 0 ? (long)st.st_size : 0;
+}
+
+//***************************************************************************
+// Sample
+//  - throttle like profile: full on the straights, lifted in the curves,
+//    a bit of noise from the controller
+//***************************************************************************
+
+static void sample(int lap, int i, int* volt, int* ampere)
+{
+   double x = i / 400.0 * 2 * M_PI;
+   double u = 180 + 60 * sin(x * 3 + lap * 0.01) + (rand() % 5) - 2;
+
+   if (u > 254) u = 254;
+   if (u < 0) u = 0;
+
+   *volt = (int)u;
+   *ampere = (int)(u / 4) + (rand() % 3);
+}
+
+//***************************************************************************
+// Main
+//***************************************************************************
+
+int main(int argc, char** argv)
+{
+   const char* dir = argc > 1 ? argv[1] : ".";
+   int laps = argc > 2 ? atoi(argv[2]) : 500;
+   int samples = 400;                  // 8s laps at 20ms
+   int cycle = 20;
+   char dbPath[255+TB];
+   char storePath[255+TB];
+   sqlite3* db;
+   sqlite3_stmt* stmt;
+   long long sumTable = 0, sumStore = 0;
+   double start;
+   double tWriteTable, tWriteStore, tScanTable, tScanStore, tLapTable, tLapStore;
+
+   if (argc > 1 && (!strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")))
+   {
+      printf("Usage: tsbench [<directory>] [laps]\n");
+      return 1;
+   }
+
+   sprintf(dbPath, "%s/tsbench.db", dir);
+   sprintf(storePath, "%s/tsbench.tss", dir);
+   unlink(dbPath);
+   unlink(storePath);
+
+   printf("%d laps of 2 slots, %d samples per lap -> %d samples\n",
+          laps, samples, laps * 2 * samples);
+
+   // table, one row per sample as 'lap_profiles'
+
+   if (sqlite3_open(dbPath, &db) != SQLITE_OK)
+   {
+      printf("Can't open '%s'\n", dbPath);
+      return 1;
+   }
+
+   sqlite3_exec(db, "CREATE TABLE lap_profiles (LAP_PROFILE_ID INTEGER PRIMARY KEY AUTOINCREMENT, "
+                "PROFILE_ID INTEGER, SEQUENCE INTEGER, VOLT INTEGER, AMPERE INTEGER);", 0, 0, 0);
+   sqlite3_exec(db, "CREATE INDEX idx_lap_profiles_profile ON lap_profiles(PROFILE_ID);", 0, 0, 0);
+
+   srand(1);
+   start = msNow();
+   sqlite3_exec(db, "BEGIN;", 0, 0, 0);
+   sqlite3_prepare_v2(db, "INSERT INTO lap_profiles(PROFILE_ID,SEQUENCE,VOLT,AMPERE) VALUES(?,?,?,?);", -1, &stmt, 0);
+
+   for (int lap = 0; lap < laps; lap++)
+   {
+      for (int slot = 0; slot < 2; slot++)
+      {
+         for (int i = 0; i < samples; i++)
+         {
+            int u, a;
+
+            sample(lap, i, &u, &a);
+            sqlite3_bind_int(stmt, 1, lap * 2 + slot);
+            sqlite3_bind_int(stmt, 2, i);
+            sqlite3_bind_int(stmt, 3, u);
+            sqlite3_bind_int(stmt, 4, a);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+         }
+      }
+   }
+
+   sqlite3_finalize(stmt);
+   sqlite3_exec(db, "COMMIT;", 0, 0, 0);
+   tWriteTable = msNow() - start;
+
+   // store, one block per lap and slot
+
+   TsWriter writer(storePath);
+
+   if (writer.open() != success)
+   {
+      printf("Can't open '%s'\n", storePath);
+      return 1;
+   }
+
+   srand(1);
+   start = msNow();
+
+   for (int lap = 0; lap < laps; lap++)
+   {
+      for (int slot = 0; slot < 2; slot++)
+      {
+         TsStore::Series* series = new TsStore::Series;
+
+         series->raceId = 1;
+         series->slot = slot;
+         series->lap = lap;
+         series->channels = 2;
+
+         for (int i = 0; i < samples; i++)
+         {
+            int u, a;
+
+            sample(lap, i, &u, &a);
+            series->times.append(((long long)lap * samples + i) * cycle * 1000LL);
+            series->values[0].append(u);
+            series->values[1].append(a);
+         }
+
+         writer.append(series);
+      }
+   }
+
+   writer.close();
+   tWriteStore = msNow() - start;
+
+   // full scan
+
+   start = msNow();
+   sqlite3_prepare_v2(db, "SELECT VOLT, AMPERE FROM lap_profiles ORDER BY PROFILE_ID, SEQUENCE;", -1, &stmt, 0);
+
+   while (sqlite3_step(stmt) == SQLITE_ROW)
+      sumTable += sqlite3_column_int(stmt, 0) + sqlite3_column_int(stmt, 1);
+
+   sqlite3_finalize(stmt);
+   tScanTable = msNow() - start;
+
+   TsReader reader;
+   TsStore::Series series;
+
+   start = msNow();
+   reader.open(storePath);
+
+   for (int b = 0; b < reader.getCount(); b++)
+   {
+      reader.read(b, &series);
+
+      for (int i = 0; i < series.times.size(); i++)
+         sumStore += series.values[0].at(i) + series.values[1].at(i);
+   }
+
+   tScanStore = msNow() - start;
+
+   // one lap (slot 1) in the middle
+
+   start = msNow();
+   sqlite3_prepare_v2(db, "SELECT VOLT, AMPERE FROM lap_profiles WHERE PROFILE_ID = ? ORDER BY SEQUENCE;", -1, &stmt, 0);
+
+   for (int lap = 0; lap < laps; lap += 10)
+   {
+      sqlite3_bind_int(stmt, 1, lap * 2 + 1);
+
+      while (sqlite3_step(stmt) == SQLITE_ROW)
+         ;
+
+      sqlite3_reset(stmt);
+   }
+
+   sqlite3_finalize(stmt);
+   tLapTable = msNow() - start;
+
+   start = msNow();
+
+   for (int lap = 0; lap < laps; lap += 10)
+   {
+      QList<int> found;
+
+      if (reader.find(1, 1, lap, found))
+         reader.read(found.at(0), &series);
+   }
+
+   tLapStore = msNow() - start;
+
+   sqlite3_close(db);
+
+   // report
+
+   printf("\n%-22s %14s %14s\n", "", "lap_profiles", "store");
+   printf("%-22s %14ld %14ld\n", "size [byte]", fileSize(dbPath), fileSize(storePath));
+   printf("%-22s %14.2f %14.2f\n", "byte per sample", (double)fileSize(dbPath) / (laps * 2 * samples),
+          (double)fileSize(storePath) / (laps * 2 * samples));
+   printf("%-22s %14.1f %14.1f\n", "write [ms]", tWriteTable, tWriteStore);
+   printf("%-22s %14.1f %14.1f\n", "full scan [ms]", tScanTable, tScanStore);
+   printf("%-22s %14.1f %14.1f\n", "lap lookups [ms]", tLapTable, tLapStore);
+   printf("\nchecksum %s (%lld / %lld)\n", sumTable == sumStore ? "ok" : "DIFFERS", sumTable, sumStore);
+
+   return sumTable == sumStore ? 0 : 1;
+}
@@ -0,0 +1,871 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File tsstore.cc
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#endif
+
+#include <common.hpp>
+#include <tsstore.hpp>
+
+//***************************************************************************
+// Bit Writer / Reader
+//  - the bits are packed LSB first
+//***************************************************************************
+
+class BitWriter
+{
+   public:
+
+      BitWriter(QByteArray& aData) : data(aData)  { acc = 0; bits = 0; }
+
+      void put(uint64_t value, int width)
+      {
+         if (width > 32)
+         {
+            put(value & 0xFFFFFFFF, 32);
+            put(value >> 32, width - 32);
+            return ;
+         }
+
+         if (width < 32)
+            value &= (1ULL << width) - 1;
+
+         acc |= value << bits;
+         bits += width;
+
+         while (bits >= 8)
+         {
+            data.append((char)(acc & 0xFF));
+            acc >>= 8;
+            bits -= 8;
+         }
+      }
+
+      void finish()
+      {
+         if (bits)
+            data.append((char)(acc & 0xFF));
+
+         acc = 0;
+         bits = 0;
+      }
+
+   protected:
+
+      QByteArray& data;
+      uint64_t acc;
+      int bits;
+};
+
+class BitReader
+{
+   public:
+
+      BitReader(const char* aData, size_t aSize)
+      {
+         data = (const uint8_t*)aData;
+         size = aSize;
+         pos = 0;
+         acc = 0;
+         bits = 0;
+         overrun = no;
+      }
+
+      uint64_t get(int width)
+      {
+         if (width > 32)
+         {
+            uint64_t low = get(32);
+            return low | (get(width - 32) << 32);
+         }
+
+         while (bits < width)
+         {
+            if (pos >= size)
+            {
+               overrun = yes;
+               return 0;
+            }
+
+            acc |= (uint64_t)data[pos++] << bits;
+            bits += 8;
+         }
+
+         uint64_t value = width < 64 ? acc & ((1ULL << width) - 1) : acc;
+
+         acc >>= width;
+         bits -= width;
+
+         return value;
+      }
+
+      int isOverrun()  { return overrun; }
+
+   protected:
+
+      const uint8_t* data;
+      size_t size;
+      size_t pos;
+      uint64_t acc;
+      int bits;
+      int overrun;
+};
+
+//***************************************************************************
+// Delta-of-Delta
+//  - zigzag coded, the prefix gives the width:
+//      0 -> 0, 10 -> 7 bit, 110 -> 12 bit, 1110 -> 20 bit, 1111 -> 64 bit
+//  - samples of a constant cycle cost one bit each
+//***************************************************************************
+
+static const int dodWidths[] = { 0, 7, 12, 20, 64 };
+
+static void putDod(BitWriter& writer, int64_t dod)
+{
+   uint64_t zz = ((uint64_t)dod << 1) ^ (uint64_t)(dod >> 63);
+   int level = 0;
+
+   while (level < 4 && zz >= (1ULL << dodWidths[level]))
+      level++;
+
+   for (int i = 0; i < level; i++)
+      writer.put(1, 1);
+
+   if (level < 4)
+      writer.put(0, 1);
+
+   writer.put(zz, dodWidths[level]);
+}
+
+static int64_t getDod(BitReader& reader)
+{
+   int level = 0;
+
+   while (level < 4 && reader.get(1))
+      level++;
+
+   uint64_t zz = reader.get(dodWidths[level]);
+
+   return (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+}
+
+//***************************************************************************
+// Class TsStore
+//***************************************************************************
+//***************************************************************************
+// Encode
+//***************************************************************************
+
+int TsStore::encode(const Series* series, BlockHeader* header, QByteArray& data)
+{
+   int count = series->times.size();
+   BitWriter writer(data);
+
+   if (series->channels < 0 || series->channels > maxChannels)
+      return fail;
+
+   for (int c = 0; c < series->channels; c++)
+      if (series->values[c].size() != count)
+         return fail;
+
+   data.clear();
+   memset(header, 0, sizeof(BlockHeader));
+   strcpy(header->magic, "BLK");
+   header->type = btData;
+   header->channels = series->channels;
+   header->slot = series->slot;
+   header->raceId = series->raceId;
+   header->lap = series->lap;
+   header->count = count;
+
+   if (count)
+   {
+      header->first = series->times.at(0);
+      header->last = series->times.at(count-1);
+   }
+
+   // time column
+
+   int64_t delta = 0;
+
+   if (count)
+      writer.put(series->times.at(0), 64);
+
+   for (int i = 1; i < count; i++)
+   {
+      int64_t d = series->times.at(i) - series->times.at(i-1);
+
+      putDod(writer, d - delta);
+      delta = d;
+   }
+
+   // value columns, base and width, then the offsets to the base
+
+   for (int c = 0; c < series->channels; c++)
+   {
+      const QVector<int32_t>& values = series->values[c];
+      int32_t min = 0, max = 0;
+      int width = 0;
+
+      for (int i = 0; i < count; i++)
+      {
+         if (!i || values.at(i) < min) min = values.at(i);
+         if (!i || values.at(i) > max) max = values.at(i);
+      }
+
+      uint64_t range = (uint64_t)((int64_t)max - (int64_t)min);
+
+      while (width < 32 && (range >> width))
+         width++;
+
+      writer.put((uint32_t)min, 32);
+      writer.put(width, 6);
+
+      for (int i = 0; i < count; i++)
+         writer.put((uint32_t)((int64_t)values.at(i) - min), width);
+   }
+
+   writer.finish();
+
+   header->size = data.size();
+   header->checksum = checksum(data.constData(), data.size());
+
+   return success;
+}
+
+//***************************************************************************
+// Decode
+//***************************************************************************
+
+int TsStore::decode(const BlockHeader* header, const char* data, Series* series)
+{
+   BitReader reader(data, header->size);
+   int count = header->count;
+
+   if (header->type != btData || header->channels > maxChannels)
+      return fail;
+
+   series->raceId = header->raceId;
+   series->slot = header->slot;
+   series->lap = header->lap;
+   series->channels = header->channels;
+   series->times.resize(count);
+
+   if (count)
+      series->times[0] = (int64_t)reader.get(64);
+
+   int64_t delta = 0;
+
+   for (int i = 1; i < count; i++)
+   {
+      delta += getDod(reader);
+      series->times[i] = series->times.at(i-1) + delta;
+   }
+
+   for (int c = 0; c < header->channels; c++)
+   {
+      int32_t min = (int32_t)reader.get(32);
+      int width = reader.get(6);
+
+      if (width > 32)
+         return fail;
+
+      series->values[c].resize(count);
+
+      for (int i = 0; i < count; i++)
+         series->values[c][i] = (int32_t)(min + (uint32_t)reader.get(width));
+   }
+
+   return reader.isOverrun() ? fail : success;
+}
+
+//***************************************************************************
+// Checksum (FNV-1a)
+//***************************************************************************
+
+uint32_t TsStore::checksum(const char* data, size_t size)
+{
+   uint32_t hash = 2166136261u;
+
+   for (size_t i = 0; i < size; i++)
+   {
+      hash ^= (uint8_t)data[i];
+      hash *= 16777619u;
+   }
+
+   return hash;
+}
+
+//***************************************************************************
+// Is Block
+//  - plausible header and data within the 'left' bytes
+//***************************************************************************
+
+int TsStore::isBlock(const BlockHeader* header, size_t left)
+{
+   if (left < sizeof(BlockHeader) || memcmp(header->magic, "BLK", 4) != 0)
+      return no;
+
+   if ((header->type != btData && header->type != btDrop) || header->channels > maxChannels)
+      return no;
+
+   return header->size <= left - sizeof(BlockHeader);
+}
+
+//***************************************************************************
+// Class TsReader
+//***************************************************************************
+
+TsReader::TsReader()
+{
+   path = 0;
+   map = 0;
+   mapSize = 0;
+   validSize = 0;
+   dataSize = 0;
+}
+
+TsReader::~TsReader()
+{
+   close();
+   free(path);
+}
+
+//***************************************************************************
+// Open / Close
+//***************************************************************************
+
+int TsReader::open(const char* aPath)
+{
+#ifdef _WIN32
+   return fail;
+#else
+   struct stat st;
+   void* m;
+   int fd;
+
+   close();
+
+   if (aPath != path)
+   {
+      free(path);
+      path = strdup(aPath);
+   }
+
+   if ((fd = ::open(path, O_RDONLY)) < 0 || fstat(fd, &st) < 0)
+   {
+      if (fd >= 0) ::close(fd);
+      return fail;
+   }
+
+   if ((size_t)st.st_size < sizeof(TsStore::FileHeader))
+   {
+      ::close(fd);
+      return fail;
+   }
+
+   m = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   ::close(fd);
+
+   if (m == MAP_FAILED)
+      return fail;
+
+   map = (const char*)m;
+   mapSize = st.st_size;
+
+   const TsStore::FileHeader* header = (const TsStore::FileHeader*)map;
+
+   if (memcmp(header->magic, "LSTSDB", 7) != 0 || header->version != TsStore::version)
+   {
+      tell(eloAlways, "Error: '%s' is not a time series store of this version", path);
+      close();
+      return fail;
+   }
+
+   return build();
+#endif
+}
+
+void TsReader::close()
+{
+#ifndef _WIN32
+   if (map)
+      munmap((void*)map, mapSize);
+#endif
+
+   map = 0;
+   mapSize = 0;
+   validSize = 0;
+   dataSize = 0;
+   index.clear();
+}
+
+//***************************************************************************
+// Refresh
+//  - map the file again if it grew, the store is append only so
+//    the index is continued at the end of the last valid block
+//***************************************************************************
+
+int TsReader::refresh()
+{
+#ifdef _WIN32
+   return fail;
+#else
+   struct stat st;
+   void* m;
+   int fd;
+
+   if (!path)
+      return fail;
+
+   if (!map)
+      return open(path);
+
+   if (stat(path, &st) != 0)
+      return fail;
+
+   if ((size_t)st.st_size == mapSize)
+      return done;
+
+   // cut by the writer -> index again
+
+   if ((size_t)st.st_size < mapSize)
+      return open(path);
+
+   if ((fd = ::open(path, O_RDONLY)) < 0)
+      return fail;
+
+   m = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+   ::close(fd);
+
+   if (m == MAP_FAILED)
+      return fail;
+
+   munmap((void*)map, mapSize);
+   map = (const char*)m;
+   mapSize = st.st_size;
+
+   return build(validSize);
+#endif
+}
+
+//***************************************************************************
+// Build
+//  - walk the block headers, only the checksum of the last block is
+//    verified here (a crash tears the tail only)
+//  - 'from' continues the index at this offset, 0 builds it from scratch
+//***************************************************************************
+
+int TsReader::build(size_t from)
+{
+   size_t offset = from ? from : sizeof(TsStore::FileHeader);
+   size_t lastOffset = 0;
+
+   if (!from)
+   {
+      index.clear();
+      dataSize = 0;
+   }
+
+   while (TsStore::isBlock((const TsStore::BlockHeader*)(map + offset), mapSize - offset))
+   {
+      const TsStore::BlockHeader* header = (const TsStore::BlockHeader*)(map + offset);
+
+      lastOffset = offset;
+
+      if (header->type == TsStore::btDrop)
+      {
+         for (int i = index.size()-1; i >= 0; i--)
+            if (index.at(i).raceId == (int)header->raceId)
+               index.removeAt(i);
+      }
+      else
+      {
+         Entry entry;
+
+         entry.raceId = header->raceId;
+         entry.slot = header->slot;
+         entry.lap = header->lap;
+         entry.count = header->count;
+         entry.first = header->first;
+         entry.last = header->last;
+         entry.offset = offset;
+
+         index.append(entry);
+         dataSize += header->size;
+      }
+
+      offset += sizeof(TsStore::BlockHeader) + header->size;
+   }
+
+   if (lastOffset)
+   {
+      const TsStore::BlockHeader* header = (const TsStore::BlockHeader*)(map + lastOffset);
+
+      if (TsStore::checksum(map + lastOffset + sizeof(TsStore::BlockHeader), header->size) != header->checksum)
+      {
+         if (header->type == TsStore::btData && !index.isEmpty() && index.last().offset == lastOffset)
+         {
+            dataSize -= header->size;
+            index.removeLast();
+         }
+
+         offset = lastOffset;
+      }
+   }
+
+   validSize = offset;
+
+   if (validSize < mapSize)
+      tell(eloAlways, "Warning: Time series store '%s' has (%ld) invalid byte at the end",
+           path, (long)(mapSize - validSize));
+
+   return success;
+}
+
+//***************************************************************************
+// Find
+//***************************************************************************
+
+int TsReader::find(int raceId, int slot, int lap, QList<int>& found)
+{
+   found.clear();
+
+   for (int i = 0; i < index.size(); i++)
+   {
+      const Entry& e = index.at(i);
+
+      if ((raceId == na || e.raceId == raceId) && (slot == na || e.slot == slot)
+          && (lap == na || e.lap == lap))
+         found.append(i);
+   }
+
+   return found.size();
+}
+
+//***************************************************************************
+// Last Race
+//  - race of the last block written
+//***************************************************************************
+
+int TsReader::lastRace()
+{
+   return index.isEmpty() ? na : index.last().raceId;
+}
+
+//***************************************************************************
+// Read
+//***************************************************************************
+
+int TsReader::read(int i, TsStore::Series* series)
+{
+   if (i < 0 || i >= index.size())
+      return fail;
+
+   const TsStore::BlockHeader* header = (const TsStore::BlockHeader*)(map + index.at(i).offset);
+   const char* data = map + index.at(i).offset + sizeof(TsStore::BlockHeader);
+
+   if (TsStore::checksum(data, header->size) != header->checksum)
+   {
+      tell(eloAlways, "Warning: Block at (%ld) of '%s' is corrupt", (long)index.at(i).offset, path);
+      return fail;
+   }
+
+   return TsStore::decode(header, data, series);
+}
+
+//***************************************************************************
+// Class TsWriter
+//***************************************************************************
+
+TsWriter::TsWriter(const char* aPath)
+   : QThread()
+{
+   path = strdup(aPath);
+   fd = na;
+   running = no;
+   writing = no;
+}
+
+TsWriter::~TsWriter()
+{
+   close();
+   free(path);
+}
+
+//***************************************************************************
+// Open
+//  - create the file or cut a torn block at the end, then start the thread
+//***************************************************************************
+
+int TsWriter::open()
+{
+#ifdef _WIN32
+   return fail;
+#else
+   struct stat st;
+
+   if (fd >= 0)
+      return done;
+
+   if (stat(path, &st) < 0 || !st.st_size)
+   {
+      TsStore::FileHeader header;
+
+      memset(&header, 0, sizeof(header));
+      strcpy(header.magic, "LSTSDB");
+      header.version = TsStore::version;
+
+      if ((fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0
+          || ::write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header))
+      {
+         tell(eloAlways, "Error: Creating time series store '%s' failed, %s", path, strerror(errno));
+         close();
+         return fail;
+      }
+
+      ::close(fd);
+      fd = na;
+   }
+   else
+   {
+      TsReader reader;
+
+      if (reader.open(path) != success)
+         return fail;
+
+      if (reader.getValidSize() < (size_t)st.st_size && truncate(path, reader.getValidSize()) < 0)
+      {
+         tell(eloAlways, "Error: Truncating '%s' failed, %s", path, strerror(errno));
+         return fail;
+      }
+   }
+
+   if ((fd = ::open(path, O_WRONLY | O_APPEND)) < 0)
+   {
+      tell(eloAlways, "Error: Open time series store '%s' failed, %s", path, strerror(errno));
+      return fail;
+   }
+
+   running = yes;
+   start(QThread::LowPriority);
+
+   return success;
+#endif
+}
+
+//***************************************************************************
+// Close
+//  - the thread writes the queue before it ends
+//***************************************************************************
+
+void TsWriter::close()
+{
+#ifndef _WIN32
+   if (fd < 0)
+      return ;
+
+   if (running)
+   {
+      mutex.lock();
+      running = no;
+      pending.wakeAll();
+      mutex.unlock();
+
+      wait();
+   }
+
+   ::close(fd);
+   fd = na;
+#endif
+}
+
+//***************************************************************************
+// Append / Drop / Flush
+//***************************************************************************
+
+void TsWriter::append(TsStore::Series* series)
+{
+   if (fd < 0 || !series->channels)
+   {
+      delete series;
+      return ;
+   }
+
+   mutex.lock();
+   queue.append(series);
+   pending.wakeOne();
+   mutex.unlock();
+}
+
+void TsWriter::drop(int raceId)
+{
+   TsStore::Series* series = new TsStore::Series;
+
+   if (fd < 0)
+   {
+      delete series;
+      return ;
+   }
+
+   series->raceId = raceId;
+
+   mutex.lock();
+   queue.append(series);
+   pending.wakeOne();
+   mutex.unlock();
+}
+
+void TsWriter::flush()
+{
+   mutex.lock();
+
+   while (running && (!queue.isEmpty() || writing))
+      written.wait(&mutex);
+
+   mutex.unlock();
+}
+
+//***************************************************************************
+// Run
+//***************************************************************************
+
+void TsWriter::run()
+{
+   QList<TsStore::Series*> batch;
+
+   for (;;)
+   {
+      mutex.lock();
+
+      while (running && queue.isEmpty())
+         pending.wait(&mutex);
+
+      batch = queue;
+      queue.clear();
+      writing = yes;
+      mutex.unlock();
+
+      if (batch.isEmpty())
+         break;                      // stopped and nothing left
+
+      for (int i = 0; i < batch.size(); i++)
+      {
+         write(batch.at(i));
+         delete batch.at(i);
+      }
+
+#ifndef _WIN32
+      fdatasync(fd);
+#endif
+
+      mutex.lock();
+      writing = no;
+      written.wakeAll();
+      mutex.unlock();
+   }
+
+   mutex.lock();
+   writing = no;
+   written.wakeAll();
+   mutex.unlock();
+}
+
+//***************************************************************************
+// Write
+//***************************************************************************
+
+int TsWriter::write(TsStore::Series* series)
+{
+   TsStore::BlockHeader header;
+   QByteArray data;
+
+   if (!series->channels)
+   {
+      memset(&header, 0, sizeof(header));
+      strcpy(header.magic, "BLK");
+      header.type = TsStore::btDrop;
+      header.raceId = series->raceId;
+      header.checksum = TsStore::checksum(0, 0);
+
+      return writeBlock(&header, data);
+   }
+
+   if (TsStore::encode(series, &header, data) != success)
+   {
+      tell(eloAlways, "Error: Series of race (%d) slot (%d) lap (%d) not valid, skipping",
+           series->raceId, series->slot, series->lap);
+      return fail;
+   }
+
+   return writeBlock(&header, data);
+}
+
+//***************************************************************************
+// Write Block
+//  - header and data with one write, a block is torn only by a crash
+//***************************************************************************
+
+int TsWriter::writeBlock(TsStore::BlockHeader* header, const QByteArray& data)
+{
+#ifdef _WIN32
+   return fail;
+#else
+   QByteArray block((const char*)header, sizeof(TsStore::BlockHeader));
+   const char* p;
+   size_t left;
+   off_t offset;
+
+   block.append(data);
+   p = block.constData();
+   left = block.size();
+
+   // remember the end, a partial block is cut off again
+
+   if ((offset = lseek(fd, 0, SEEK_END)) < 0)
+   {
+      tell(eloAlways, "Error: Seeking in '%s' failed, %s", path, strerror(errno));
+      return fail;
+   }
+
+   while (left)
+   {
+      ssize_t n = ::write(fd, p, left);
+
+      if (n < 0 && errno == EINTR)
+         continue;
+
+      if (n <= 0)
+      {
+         tell(eloAlways, "Error: Writing to '%s' failed, %s", path, n < 0 ? strerror(errno) : "nothing written");
+
+         if (ftruncate(fd, offset) < 0)
+            tell(eloAlways, "Error: Truncating '%s' failed, %s", path, strerror(errno));
+
+         return fail;
+      }
+
+      p += n;
+      left -= n;
+   }
+
+   return success;
+#endif
+}
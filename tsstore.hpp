@@ -0,0 +1,198 @@
+//***************************************************************************
+// Group Linslot / Linux - Slotrace Manager
+// File tsstore.hpp
+// Date 19.10.26 - Jrg Wendel
+// This code is distributed under the terms and conditions of the
+// GNU GENERAL PUBLIC LICENSE. See the file COPYING for details.
+//***************************************************************************
+
+#ifndef _TSSTORE_H_
+#define _TSSTORE_H_
+
+//***************************************************************************
+// Includes
+//***************************************************************************
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QVector>
+#include <QList>
+
+//***************************************************************************
+// Time Series Store
+//  - append only file of sample blocks: FileHeader | (BlockHeader | data)*
+//  - a block holds the samples of one race, slot and lap column by column,
+//    the time column delta-of-delta coded, each value column bit packed
+//    with the width of its range (minimum as base)
+//  - the block headers are the index (race, slot, lap -> offset), they are
+//    collected when opening, the file is read memory mapped
+//  - a torn block at the end (crash while writing) is cut off by the writer
+//  - blocks are never changed, a race is removed by a drop block which
+//    hides the blocks of the race written before
+//***************************************************************************
+
+class TsStore
+{
+   public:
+
+      enum Misc
+      {
+         version = 1,
+         maxChannels = 4
+      };
+
+      enum BlockType
+      {
+         btData = 1,
+         btDrop
+      };
+
+#pragma pack(1)
+
+      struct FileHeader               // 16 byte
+      {
+         char magic[8];               // "LSTSDB"
+         uint32_t version;
+         uint32_t reserved;
+      };
+
+      struct BlockHeader              // 48 byte
+      {
+         char magic[4];               // "BLK"
+         uint8_t type;
+         uint8_t channels;
+         uint16_t slot;
+         uint32_t raceId;
+         uint32_t lap;
+         uint32_t count;              // samples
+         uint32_t size;               // coded data following [byte]
+         int64_t first;               // time of the first and ..
+         int64_t last;                // .. the last sample [us]
+         uint32_t checksum;           // of the data
+         uint32_t reserved;
+      };
+
+#pragma pack()
+
+      //***************************************************************************
+      // Series
+      //  - the samples of a block, 'channels' value columns
+      //***************************************************************************
+
+      struct Series
+      {
+         Series()                     { raceId = 0; slot = 0; lap = 0; channels = 0; }
+
+         int raceId;
+         int slot;
+         int lap;
+         int channels;
+         QVector<int64_t> times;      // [us]
+         QVector<int32_t> values[maxChannels];
+      };
+
+      // coding
+
+      static int encode(const Series* series, BlockHeader* header, QByteArray& data);
+      static int decode(const BlockHeader* header, const char* data, Series* series);
+      static uint32_t checksum(const char* data, size_t size);
+      static int isBlock(const BlockHeader* header, size_t left);
+};
+
+//***************************************************************************
+// Class TsReader
+//  - memory mapped read access, refresh() maps and indexes only the
+//    blocks appended meanwhile, keep it open instead of opening per query
+//***************************************************************************
+
+class TsReader
+{
+   public:
+
+      struct Entry
+      {
+         int raceId;
+         int slot;
+         int lap;
+         int count;
+         int64_t first;               // [us]
+         int64_t last;                // [us]
+         size_t offset;               // of the block header
+      };
+
+      TsReader();
+      ~TsReader();
+
+      int open(const char* path);
+      void close();
+      int refresh();
+      int isOpen()                     { return map != 0; }
+
+      int getCount()                   { return index.size(); }
+      const Entry& at(int i)           { return index.at(i); }
+      size_t getValidSize()            { return validSize; }
+      size_t getDataSize()             { return dataSize; }
+
+      int find(int raceId, int slot, int lap, QList<int>& found);   // na -> any
+      int lastRace();
+      int read(int i, TsStore::Series* series);
+
+   protected:
+
+      int build(size_t from = 0);
+
+      char* path;
+      const char* map;
+      size_t mapSize;
+      size_t validSize;                // end of the last complete block
+      size_t dataSize;                 // sum of the coded data
+      QList<Entry> index;
+};
+
+//***************************************************************************
+// Class TsWriter
+//  - encodes and appends the blocks in its own thread, append() and
+//    drop() only queue
+//  - flush() waits until the queue is written
+//***************************************************************************
+
+class TsWriter : public QThread
+{
+   public:
+
+      TsWriter(const char* aPath);
+      virtual ~TsWriter();
+
+      int open();
+      void close();
+      int isOpen()                     { return fd >= 0; }
+      const char* getPath()            { return path; }
+
+      void append(TsStore::Series* series);       // takes the series
+      void drop(int raceId);
+      void flush();
+
+   protected:
+
+      void run();
+      int write(TsStore::Series* series);
+      int writeBlock(TsStore::BlockHeader* header, const QByteArray& data);
+
+      char* path;
+      int fd;
+      int running;
+      int writing;
+
+      QMutex mutex;
+      QWaitCondition pending;
+      QWaitCondition written;
+      QList<TsStore::Series*> queue;  // series without channels -> drop
+};
+
+//***************************************************************************
+#endif // _TSSTORE_H_